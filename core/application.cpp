@@ -1,6 +1,7 @@
 #include "application.h"
 #include "window.hpp"
 #include "render/renderer2D.h"
+#include "render/render_graph.h"
 #include "../runtime/runtime.h"
 
 #include <glm/glm.hpp>
@@ -23,12 +24,17 @@ Application::Application()
 
 Application::~Application()
 {
+    // The graph, the renderer's buffers and shaders and the textures are GL objects, release them while the context still exists
+    m_renderGraph.reset();
+    m_runtime.reset();
+    m_renderer2D.reset();
+    m_rssManager.reset();
     // Terminate GLFW, clearing any resources allocated by GLFW.
     // WARNING: if you have multiple application instances you might not want to do that?
     glfwTerminate();
 }
 
-bool Application::Init()
+bool Application::Init(bool bSoftware)
 {
     Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Starting Cherry Engine...");
     m_window = std::make_unique<Window>();
@@ -44,27 +50,69 @@ bool Application::Init()
 
     // Set OpenGL context and loads glad so it must be initialized first
     Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Initializing Window...");
-    if(!m_window->Init())
+    if(!bSoftware && !m_window->Init())
+    {
+        // no GPU or no driver for it(dedicated servers, virtual machines), the CPU can still render
+        Release_Log(ELogCategory::Core, EPrintColor::Yellow, "No OpenGL context could be created, falling back to the Software renderer");
+        bSoftware = true;
+    }
+    if(bSoftware && !m_window->InitSoftware())
     {
         Debug_Log(ELogCategory::Error, "Window cound not be initilzed!");
         return false;
     }
+    // The textures are kept in RAM for the rasterizer, set before anything is loaded
+    Texture::s_bCpuOnly = bSoftware;
     Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Initializing Runtime...");
     if(!m_runtime->Init())
     {
         Debug_Log(ELogCategory::Error, "Runtime cound not be initialized!");
     }
     Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Initializing Renderer...");
-    if(!m_renderer2D->Init(vertex_shared_key, fragment_shared_key, projection))
+    if(bSoftware)
+    {
+        m_renderer2D->InitSoftware(m_window->GetFramebufferWidth(), m_window->GetFramebufferHeight(), projection);
+    }
+    else if(!m_renderer2D->Init(vertex_shared_key, fragment_shared_key, projection))
     {
         Debug_Log(ELogCategory::Error, EPrintColor::Red, true, "Renderer2D failed to initialize!");
     }
+#ifdef DEBUG_MODE
+    // Edit the .glsl files while the engine runs
+    m_renderer2D->enableShaderHotReload();
+#endif /* DEBUG_MODE */
     Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Initializing InputManager...");
     InputManager::GetInstance()->Init(m_window->GetGLFWwindow()); // Init after m_window is initialized!
 
-    m_rssManager->LoadResources();
+    // The shaders started by Renderer2D::Init are still compiling in the driver while the textures decode.
+    // The first scene's textures are preloaded in one batch, anything else loads when it is first asked for.
+    m_rssManager->LoadResources({"berserk.png"_asset});
+#ifdef DEBUG_MODE
+    // Saving a texture in assets/ shows it in the running game
+    m_rssManager->EnableHotReload();
+#endif /* DEBUG_MODE */
+    m_berserkTexture = m_rssManager->GetTextureHandle("berserk.png"_asset);
     m_window->SetVSyncOff();
 
+    // The Software backend draws straight into the rasterizer's color buffer, there are no targets to order
+    if(bSoftware)
+    {
+        return true;
+    }
+
+    // Describe the frame, the graph orders the passes and owns every intermediate target
+    m_renderGraph = std::make_unique<RenderGraph>();
+    m_backbuffer = m_renderGraph->importTarget("Backbuffer", 0, 0, m_window->GetFramebufferWidth(), m_window->GetFramebufferHeight());
+    m_renderGraph->addPass("Sprites", {}, {m_backbuffer}, [this](const RenderGraph&)
+    {
+        drawSprites();
+    });
+    if(!m_renderGraph->compile())
+    {
+        Debug_Log(ELogCategory::Error, "RenderGraph could not be compiled!");
+        return false;
+    }
+
     // Example uses of the InputManager
     // InputManager::GetInstance()->BindToMouseMove([](int x, int y){ std::cout << x << " " << y << std::endl; });
     // InputManager::GetInstance()->BindMouseEvent(CHERRY_MOUSE_BUTTON_1, CHERRY_PRESS, [](){ std::cout << "Mouse clicked" << std::endl; });
@@ -105,12 +153,25 @@ void Application::Update()
         }
         m_runtime->Update(m_deltaTime);
         InputManager::GetInstance()->PollEvents();
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        // Use Renderer
-        m_renderer2D->drawQuad(glm::vec2(400.0f, 350.0f), glm::vec2(100.0f, 100.0f), m_rssManager->GetTexturePtr("berserk.png")); // Quad with texture1
+        // uploads textures that finished streaming in(bounded so loading never drops a frame)
+        // and evicts the least recently drawn ones when over the texture budget
+        m_rssManager->Update();
+        if(!m_renderGraph)
+        {
+            // Software backend, the frame stays in the rasterizer's color buffer, the window has nothing to present
+            drawSprites();
+            continue;
+        }
+        // the window may have been resized since the last frame
+        m_renderGraph->resizeImported(m_backbuffer, m_window->GetFramebufferWidth(), m_window->GetFramebufferHeight());
+        m_renderGraph->execute();
         glfwSwapBuffers(m_window->GetGLFWwindow());
     }
 }
 
+void Application::drawSprites()
+{
+    m_renderer2D->beginFrame(glm::vec4(0.2f, 0.3f, 0.3f, 1.0f));
+    m_renderer2D->drawQuad(glm::vec2(400.0f, 350.0f), glm::vec2(100.0f, 100.0f), m_rssManager->ResolveTexture(m_berserkTexture)); // Quad with texture1
+    m_renderer2D->endFrame();
+}
@@ -1,11 +1,14 @@
 #pragma once
 
 #include <singleton.h>
+#include <texture_handle.h>
+#include <cstdint>
 #include <memory>
 
 class Window;
 class Runtime;
 class Renderer2D;
+class RenderGraph;
 class ResourceManager;
 struct Position;
 
@@ -55,11 +58,13 @@ public:
      * @brief Initializes the application.
      *
      * This function sets up the application environment, including creating the window and
-     * initializing any necessary subsystems.
+     * initializing any necessary subsystems. When no OpenGL context can be created the
+     * application falls back to the Software backend.
      *
+     * @param bSoftware Render with the Software backend(CPU only, `--software` on the command line).
      * @return true if initialization is successful; false otherwise.
      */
-    bool Init();
+    bool Init(bool bSoftware = false);
 
     /**
      * @brief Updates the application state.
@@ -72,6 +77,9 @@ public:
     void Update();
 
 private:
+    // Recorded by the Sprites pass, called directly with the Software backend which has no render graph
+    void drawSprites();
+
     /**
      * @brief Unique pointer to the Window instance.
      *
@@ -86,6 +94,16 @@ private:
 
     std::shared_ptr<Renderer2D> m_renderer2D;
 
+    /**
+     * @brief Passes drawn every frame, built once in Init().
+     */
+    std::unique_ptr<RenderGraph> m_renderGraph;
+    // RenderResource of the default framebuffer, resized with the window
+    uint32_t m_backbuffer{0};
+
+    // looked up once in Init(), resolved by the Sprites pass every frame
+    TextureHandle m_berserkTexture;
+
     float m_deltaTime = 0.0f;
     // rounded fps to a whole number
     int m_fps = 0;
@@ -0,0 +1,236 @@
+#pragma once
+
+/*
+ * file_watcher_component.h reports changes to files on disk(Linux inotify).
+ * A background thread waits for inotify events and calls the registered callbacks,
+ * the callbacks therefore run on the watcher thread and must synchronize with the rest of the engine.
+ *
+ * The parent directory is watched instead of the file itself. Most editors save by writing
+ * a temporary file and renaming it over the original, which would silently end a watch on the file.
+ * Watch_Directory reports every file of a directory tree, the assets folder for example.
+ *
+ * !!! WARNINGS !!!
+ * Only implemented for Linux, on other platforms Watch_File and Watch_Directory return false.
+ */
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+class FileWatcher
+{
+public:
+    using Callback = std::function<void(const std::string& path)>;
+
+    /* opens the inotify instance, the thread starts with the first watch */
+    FileWatcher() noexcept;
+
+    /* wakes up and joins the watcher thread */
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    /**
+     * @brief Calls callback every time the file is written or replaced
+     *
+     * @param  path: file to watch, does not need to exist yet
+     * @param  callback: called on the watcher thread with the path as it was passed here
+     *
+     * @return bool: false if the directory of the file can not be watched
+     */
+    bool Watch_File(const std::string& path, Callback callback);
+
+    /**
+     * @brief Calls callback every time a file in the directory or in one of its sub directories is written or replaced
+     *
+     * @param  path: directory to watch, sub directories created afterwards are not watched
+     * @param  callback: called on the watcher thread with the path of the file(path/sub directory/file name)
+     *
+     * @return bool: false if the directory or one of its sub directories can not be watched
+     */
+    bool Watch_Directory(const std::string& path, Callback callback);
+
+private:
+    struct WatchedFile
+    {
+        std::string path;
+        Callback callback;
+    };
+
+    /* thread loop, sleeps in poll() until inotify has events or the destructor wakes it */
+    void Run();
+
+    /* inotify watch descriptor -> files watched in that directory by file name */
+    std::unordered_map<int, std::unordered_multimap<std::string, WatchedFile>> m_watches;
+    /* inotify watch descriptor -> watches of every file in that directory, path is the directory */
+    std::unordered_map<int, std::vector<WatchedFile>> m_directories;
+    std::mutex m_mutex;
+    std::thread m_thread;
+    std::atomic<bool> m_bStop{false};
+    int m_inotify{-1};
+    int m_wake{-1};
+};
+
+inline FileWatcher::FileWatcher() noexcept
+{
+#if defined(__linux__)
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+}
+
+inline FileWatcher::~FileWatcher()
+{
+#if defined(__linux__)
+    m_bStop = true;
+    if(m_thread.joinable())
+    {
+        uint64_t one = 1;
+        [[maybe_unused]] ssize_t written = write(m_wake, &one, sizeof(one));
+        m_thread.join();
+    }
+    if(m_inotify != -1) { close(m_inotify); }
+    if(m_wake != -1) { close(m_wake); }
+#endif
+}
+
+inline bool FileWatcher::Watch_File(const std::string& path, Callback callback)
+{
+#if defined(__linux__)
+    if(m_inotify == -1 || m_wake == -1)
+    {
+        return false;
+    }
+    std::filesystem::path filePath(path);
+    std::string directory = filePath.has_parent_path() ? filePath.parent_path().string() : ".";
+    /* watching the same directory twice returns the same descriptor */
+    int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if(watch == -1)
+    {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_watches[watch].emplace(filePath.filename().string(), WatchedFile{path, std::move(callback)});
+    }
+    if(!m_thread.joinable())
+    {
+        m_thread = std::thread(&FileWatcher::Run, this);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline bool FileWatcher::Watch_Directory(const std::string& path, Callback callback)
+{
+#if defined(__linux__)
+    if(m_inotify == -1 || m_wake == -1)
+    {
+        return false;
+    }
+    /* inotify is not recursive, every sub directory gets a watch of its own */
+    std::vector<std::string> directories{path};
+    std::error_code error;
+    for(auto it = std::filesystem::recursive_directory_iterator(path, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error))
+    {
+        if(it->is_directory())
+        {
+            directories.push_back(it->path().string());
+        }
+    }
+    if(error)
+    {
+        return false;
+    }
+    for(const std::string& directory : directories)
+    {
+        int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if(watch == -1)
+        {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_directories[watch].push_back(WatchedFile{directory, callback});
+    }
+    if(!m_thread.joinable())
+    {
+        m_thread = std::thread(&FileWatcher::Run, this);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline void FileWatcher::Run()
+{
+#if defined(__linux__)
+    /* inotify events are variable sized, the buffer must be aligned for inotify_event */
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{m_inotify, POLLIN, 0}, {m_wake, POLLIN, 0}};
+    std::vector<WatchedFile> changed;
+    while(!m_bStop)
+    {
+        if(poll(fds, 2, -1) <= 0 || (fds[1].revents & POLLIN))
+        {
+            continue; /* interrupted or woken up to stop */
+        }
+        ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+        if(length <= 0)
+        {
+            continue;
+        }
+
+        changed.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for(char* cursor = buffer; cursor < buffer + length;)
+            {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(cursor);
+                cursor += sizeof(inotify_event) + event->len;
+                if(event->len == 0 || (event->mask & IN_ISDIR))
+                {
+                    continue;
+                }
+                auto directory = m_watches.find(event->wd);
+                if(directory != m_watches.end())
+                {
+                    auto [begin, end] = directory->second.equal_range(event->name);
+                    for(auto it = begin; it != end; ++it)
+                    {
+                        changed.push_back(it->second);
+                    }
+                }
+                auto tree = m_directories.find(event->wd);
+                if(tree != m_directories.end())
+                {
+                    for(const WatchedFile& watched : tree->second)
+                    {
+                        changed.push_back(WatchedFile{(std::filesystem::path(watched.path) / event->name).string(), watched.callback});
+                    }
+                }
+            }
+        }
+        /* callbacks run without the lock so they may add new watches */
+        for(const WatchedFile& file : changed)
+        {
+            file.callback(file.path);
+        }
+    }
+#endif
+}
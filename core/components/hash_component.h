@@ -0,0 +1,204 @@
+#pragma once
+
+/*
+ * Hash functions shared by the engine.
+ * FNV-1a is constexpr so names known at compile time(uniforms for example)
+ * are hashed by the compiler and cost nothing at runtime.
+ * Hash_Bytes_64 is for large buffers(decoded pixels for example), FNV-1a handles one byte at a time.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief 32 bit FNV-1a hash of a string
+ *
+ * @param str: string to hash
+ *
+ * @return uint32_t: hash of the string
+ */
+constexpr uint32_t Hash_Fnv1a_32(std::string_view str) noexcept
+{
+    uint32_t hash = 2166136261u;
+    for(char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief 64 bit FNV-1a hash of a string
+ *
+ * @param str: string to hash
+ *
+ * @return uint64_t: hash of the string
+ */
+constexpr uint64_t Hash_Fnv1a_64(std::string_view str) noexcept
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(char c : str)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+namespace Hash_Detail
+{
+    inline constexpr uint64_t s_prime32_1 = 0x9E3779B1u;
+    inline constexpr uint64_t s_prime64_1 = 0x9E3779B185EBCA87ull;
+    inline constexpr uint64_t s_prime64_2 = 0xC2B2AE3D27D4EB4Full;
+    inline constexpr uint64_t s_prime64_3 = 0x165667B19E3779F9ull;
+    inline constexpr uint64_t s_prime64_4 = 0x85EBCA77C2B2AE63ull;
+    inline constexpr uint64_t s_prime64_5 = 0x27D4EB2F165667C5ull;
+    inline constexpr size_t s_stripeSize = 64;
+    // stripes between two scrambles of the accumulators
+    inline constexpr size_t s_stripesPerBlock = 16;
+
+    // Stripe n of a block is keyed with s_secret[n..n+7], the same bytes in two stripes of a block then
+    // add different values(otherwise moving a change to another stripe would give the same hash)
+    struct Secret
+    {
+        uint64_t words[8 + s_stripesPerBlock];
+    };
+
+    // splitmix64 sequence, any random looking words will do
+    constexpr Secret Make_Secret() noexcept
+    {
+        Secret secret{};
+        uint64_t state = 0x9E3779B97F4A7C15ull;
+        for(uint64_t& word : secret.words)
+        {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t mixed = state;
+            mixed = (mixed ^ (mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+            mixed = (mixed ^ (mixed >> 27)) * 0x94D049BB133111EBull;
+            word = mixed ^ (mixed >> 31);
+        }
+        return secret;
+    }
+
+    inline constexpr Secret s_secret = Make_Secret();
+
+    inline uint64_t Read_64(const uint8_t* data) noexcept
+    {
+        uint64_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Rotate_Left(uint64_t value, int count) noexcept
+    {
+        return (value << count) | (value >> (64 - count));
+    }
+
+    // Adds one 64 byte stripe to the 8 lanes, every lane multiplies the two halves of its keyed input
+    // and the input itself goes to the neighbour lane so no byte can cancel out
+    inline void Accumulate_Stripe(uint64_t* accumulators, const uint8_t* stripe, const uint64_t* secret) noexcept
+    {
+#if defined(__SSE2__)
+        __m128i* lanes = reinterpret_cast<__m128i*>(accumulators);
+        for(int i = 0; i < 4; ++i)
+        {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe) + i);
+            const __m128i key = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+            const __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(2, 3, 0, 1)));
+            const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            lanes[i] = _mm_add_epi64(_mm_add_epi64(lanes[i], swapped), product);
+        }
+#else
+        for(int i = 0; i < 8; ++i)
+        {
+            const uint64_t data = Read_64(stripe + i * 8);
+            const uint64_t key = data ^ secret[i];
+            accumulators[i ^ 1] += data;
+            accumulators[i] += (key & 0xFFFFFFFFu) * (key >> 32);
+        }
+#endif
+    }
+
+    // Spreads the high bits of the lanes back into the low ones the multiplies read
+    inline void Scramble(uint64_t* accumulators) noexcept
+    {
+        const uint64_t* secret = s_secret.words + s_stripesPerBlock;
+#if defined(__SSE2__)
+        __m128i* lanes = reinterpret_cast<__m128i*>(accumulators);
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(s_prime32_1));
+        for(int i = 0; i < 4; ++i)
+        {
+            __m128i lane = _mm_xor_si128(lanes[i], _mm_srli_epi64(lanes[i], 47));
+            lane = _mm_xor_si128(lane, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+            // 64 x 32 bit multiply from two 32 x 32 ones
+            const __m128i low = _mm_mul_epu32(lane, prime);
+            const __m128i high = _mm_slli_epi64(_mm_mul_epu32(_mm_srli_epi64(lane, 32), prime), 32);
+            lanes[i] = _mm_add_epi64(low, high);
+        }
+#else
+        for(int i = 0; i < 8; ++i)
+        {
+            uint64_t lane = accumulators[i] ^ (accumulators[i] >> 47);
+            lane ^= secret[i];
+            accumulators[i] = lane * s_prime32_1;
+        }
+#endif
+    }
+
+    inline uint64_t Avalanche(uint64_t hash) noexcept
+    {
+        hash ^= hash >> 33;
+        hash *= s_prime64_2;
+        hash ^= hash >> 29;
+        hash *= s_prime64_3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+}
+
+/**
+ * @brief 64 bit hash of a buffer in the style of XXH3: 8 lanes over 64 byte stripes, SSE2 when available.
+ * The SSE2 and the scalar path give the same hash. Several GB/s, for buffers of a few KB and up.
+ *
+ * @param data, size: bytes to hash
+ * @param seed: different seeds give unrelated hashes of the same bytes
+ *
+ * @return uint64_t: hash of the bytes
+ */
+inline uint64_t Hash_Bytes_64(const void* data, size_t size, uint64_t seed = 0) noexcept
+{
+    using namespace Hash_Detail;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    alignas(16) uint64_t accumulators[8] = {s_prime32_1 ^ seed, s_prime64_1, s_prime64_2, s_prime64_3,
+                                            s_prime64_4, s_prime64_5 + seed, s_prime64_1 ^ ~seed, s_prime64_2 - seed};
+
+    size_t stripe = 0;
+    for(; (stripe + 1) * s_stripeSize <= size; ++stripe)
+    {
+        Accumulate_Stripe(accumulators, bytes + stripe * s_stripeSize, s_secret.words + stripe % s_stripesPerBlock);
+        if((stripe + 1) % s_stripesPerBlock == 0)
+        {
+            Scramble(accumulators);
+        }
+    }
+    // the tail is zero padded, the length mixed in below tells apart inputs that differ only in trailing zeros
+    uint8_t last[s_stripeSize] = {};
+    std::memcpy(last, bytes + stripe * s_stripeSize, size - stripe * s_stripeSize);
+    Accumulate_Stripe(accumulators, last, s_secret.words + s_stripesPerBlock - 1);
+    Scramble(accumulators);
+
+    uint64_t hash = static_cast<uint64_t>(size) * s_prime64_1 + seed;
+    for(uint64_t lane : accumulators)
+    {
+        hash ^= Rotate_Left(lane * s_prime64_2, 31) * s_prime64_1;
+        hash = Rotate_Left(hash, 27) * s_prime64_1 + s_prime64_4;
+    }
+    return Avalanche(hash);
+}
@@ -1,6 +1,7 @@
 #include "application.h"
 #include <heap_memory_track_component.h>
 #include <debug_logger_component.h>
+#include <cstring>
 
 #ifdef DEBUG_MODE
 // TRACK_HEAP_AND_LEAKS() // start tracking heap
@@ -9,8 +10,14 @@
 
 int main(int argc, char* argv[])
 {
+    // --software renders on the CPU, also picked when no OpenGL context can be created
+    bool bSoftware = false;
+    for(int i = 1; i < argc; ++i)
+    {
+        bSoftware |= std::strcmp(argv[i], "--software") == 0;
+    }
     Application* App = Application::GetInstance();
-    if(!App->Init())
+    if(!App->Init(bSoftware))
     {
         Debug_Log(ELogCategory::Error, "Application could not Init!");
     }
@@ -0,0 +1,533 @@
+#include "basic_shader.h"
+
+#include <debug_logger_component.h>
+#include <file_watcher_component.h>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+/* Header of a cached program binary, the binary itself follows */
+struct ProgramBinaryHeader
+{
+    uint32_t magic;
+    uint32_t format;
+    uint64_t key;
+    uint32_t size;
+};
+
+static constexpr uint32_t s_programBinaryMagic = 0x42534843; // "CHSB"
+
+// Program binaries are only valid for the driver that produced them
+static std::string Driver_Id()
+{
+    std::string id;
+    for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    {
+        const GLubyte* value = glGetString(name);
+        id += value ? reinterpret_cast<const char*>(value) : "";
+        id += '\n';
+    }
+    return id;
+}
+
+static bool Program_Binaries_Supported()
+{
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+    {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+// Reads a whole text file, returns false if it could not be opened or read
+static bool Read_File(const std::string& path, std::string& content)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return !file.bad();
+}
+
+// GLSL requires #version to be the first statement, the defines go right after it
+static void Inject_Defines(std::string& code, const std::string& defines)
+{
+    if (defines.empty())
+    {
+        return;
+    }
+    size_t version = code.find("#version");
+    size_t position = version == std::string::npos ? 0 : code.find('\n', version);
+    position = position == std::string::npos ? code.size() : position + 1;
+    if (position == code.size() && !code.empty() && code.back() != '\n')
+    {
+        code += '\n';
+        position = code.size();
+    }
+    code.insert(position, defines);
+}
+
+static std::string Program_Binary_Path(uint64_t key)
+{
+    char fileName[32];
+    std::snprintf(fileName, sizeof(fileName), "%016llx.bin", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(Shader::s_binaryCacheDirectory) / fileName).string();
+}
+
+// Asks the driver to compile on as many threads as it likes, once per context
+static void Enable_Parallel_Compile()
+{
+    static bool s_bRequested = false;
+    if (s_bRequested)
+    {
+        return;
+    }
+    s_bRequested = true;
+    if (GLAD_GL_KHR_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines)
+    : Shader(readSources(vertexPath, fragmentPath, defines))
+{
+    waitForBuild();
+}
+
+Shader::Shader(ShaderSources sources)
+    : m_vertexPath(std::move(sources.vertexPath)), m_fragmentPath(std::move(sources.fragmentPath)), m_defines(std::move(sources.defines))
+{
+    // 1. The sources were read by readSources(), possibly on another thread
+    if (!sources.bRead)
+    {
+        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+    }
+
+    // 2. Try the binary cache, the key covers both sources and the driver
+    const bool bBinaryCache = Program_Binaries_Supported();
+    if (bBinaryCache)
+    {
+        m_binaryKey = Hash_Fnv1a_64(sources.vertexCode + '\0' + sources.fragmentCode + '\0' + Driver_Id());
+        if (loadProgramBinary(Program_Binary_Path(m_binaryKey), m_binaryKey))
+        {
+            cacheUniformLocations();
+            return;
+        }
+    }
+
+    // 3. Compile and link, completed by pollBuild()/waitForBuild()
+    Enable_Parallel_Compile();
+    m_build = beginBuild(sources.vertexCode, sources.fragmentCode, bBinaryCache);
+}
+
+Shader::~Shader()
+{
+    release();
+}
+
+Shader::Shader(Shader&& other) noexcept
+    : ID(std::exchange(other.ID, 0)),
+      m_bLinked(std::exchange(other.m_bLinked, false)),
+      m_build(std::exchange(other.m_build, PendingProgram{})),
+      m_binaryKey(other.m_binaryKey),
+      m_uniforms(std::move(other.m_uniforms)),
+      m_vertexPath(std::move(other.m_vertexPath)),
+      m_fragmentPath(std::move(other.m_fragmentPath)),
+      m_defines(std::move(other.m_defines)),
+      m_hotReload(std::move(other.m_hotReload))
+{
+}
+
+Shader& Shader::operator=(Shader&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        ID = std::exchange(other.ID, 0);
+        m_bLinked = std::exchange(other.m_bLinked, false);
+        m_build = std::exchange(other.m_build, PendingProgram{});
+        m_binaryKey = other.m_binaryKey;
+        m_uniforms = std::move(other.m_uniforms);
+        m_vertexPath = std::move(other.m_vertexPath);
+        m_fragmentPath = std::move(other.m_fragmentPath);
+        m_defines = std::move(other.m_defines);
+        m_hotReload = std::move(other.m_hotReload);
+    }
+    return *this;
+}
+
+void Shader::release()
+{
+    // glDelete* ignores 0, a moved from Shader owns nothing
+    auto deleteBuild = [](PendingProgram& build)
+    {
+        glDeleteShader(build.vertex);
+        glDeleteShader(build.fragment);
+        glDeleteProgram(build.program);
+        build = PendingProgram{};
+    };
+    if (m_build.program != 0)
+    {
+        deleteBuild(m_build);
+    }
+    if (m_hotReload)
+    {
+        std::lock_guard<std::mutex> lock(m_hotReload->mutex);
+        if (m_hotReload->build.program != 0)
+        {
+            deleteBuild(m_hotReload->build);
+        }
+    }
+    if (ID != 0)
+    {
+        glDeleteProgram(ID);
+        ID = 0;
+    }
+    m_bLinked = false;
+}
+
+ShaderSources Shader::readSources(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines)
+{
+    ShaderSources sources;
+    sources.vertexPath = vertexPath;
+    sources.fragmentPath = fragmentPath;
+    sources.defines = defines;
+    sources.bRead = Read_File(vertexPath, sources.vertexCode) && Read_File(fragmentPath, sources.fragmentCode);
+    Inject_Defines(sources.vertexCode, defines);
+    Inject_Defines(sources.fragmentCode, defines);
+    return sources;
+}
+
+ShaderSources Shader::withDefines(const ShaderSources& sources, const std::string& defines)
+{
+    ShaderSources result = sources;
+    result.defines = sources.defines + defines;
+    Inject_Defines(result.vertexCode, defines);
+    Inject_Defines(result.fragmentCode, defines);
+    return result;
+}
+
+bool Shader::pollBuild()
+{
+    if (isBuilt())
+    {
+        return true;
+    }
+    if (!isBuildComplete(m_build))
+    {
+        return false;
+    }
+    completeBuild();
+    return true;
+}
+
+void Shader::waitForBuild()
+{
+    if (!isBuilt())
+    {
+        // the status queries in finishBuild() wait for the driver
+        completeBuild();
+    }
+}
+
+void Shader::completeBuild()
+{
+    m_bLinked = finishBuild(m_build);
+    ID = m_build.program;
+    m_build = PendingProgram{};
+    if (m_bLinked)
+    {
+        cacheUniformLocations();
+        if (m_binaryKey != 0)
+        {
+            saveProgramBinary(Program_Binary_Path(m_binaryKey), m_binaryKey);
+        }
+    }
+}
+
+void Shader::watchSources(FileWatcher& watcher)
+{
+    m_hotReload = std::make_shared<HotReloadState>();
+    // Runs on the watcher thread, the GL thread only ever sees complete sources
+    auto onChange = [state = m_hotReload, vertexPath = m_vertexPath, fragmentPath = m_fragmentPath, defines = m_defines](const std::string& path)
+    {
+        std::string vertexCode;
+        std::string fragmentCode;
+        if (!Read_File(vertexPath, vertexCode) || !Read_File(fragmentPath, fragmentCode))
+        {
+            return; // the editor may still be writing, the next event brings the full file
+        }
+        Inject_Defines(vertexCode, defines);
+        Inject_Defines(fragmentCode, defines);
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->vertexCode = std::move(vertexCode);
+        state->fragmentCode = std::move(fragmentCode);
+        state->bPending = true;
+    };
+    watcher.Watch_File(m_vertexPath, onChange);
+    watcher.Watch_File(m_fragmentPath, onChange);
+}
+
+bool Shader::pollHotReload()
+{
+    if (!m_hotReload || !pollBuild())
+    {
+        return false; // the first build has to finish before it can be replaced
+    }
+    HotReloadState& state = *m_hotReload;
+
+    // Start a build when the sources changed and no build is running
+    if (state.build.program == 0)
+    {
+        std::string vertexCode;
+        std::string fragmentCode;
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (!state.bPending)
+            {
+                return false;
+            }
+            vertexCode = std::move(state.vertexCode);
+            fragmentCode = std::move(state.fragmentCode);
+            state.bPending = false;
+        }
+        const bool bBinaryCache = Program_Binaries_Supported();
+        state.key = bBinaryCache ? Hash_Fnv1a_64(vertexCode + '\0' + fragmentCode + '\0' + Driver_Id()) : 0;
+        state.build = beginBuild(vertexCode, fragmentCode, bBinaryCache);
+    }
+
+    // Check back next frame while the driver is still compiling
+    if (!isBuildComplete(state.build))
+    {
+        return false;
+    }
+    PendingProgram build = state.build;
+    state.build = PendingProgram{};
+    if (!finishBuild(build))
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Hot reload of ", m_vertexPath, " / ", m_fragmentPath, " failed, keeping the old program");
+        return false;
+    }
+
+    glDeleteProgram(ID);
+    ID = build.program;
+    m_bLinked = true;
+    cacheUniformLocations();
+    if (state.key != 0)
+    {
+        saveProgramBinary(Program_Binary_Path(state.key), state.key);
+    }
+    Debug_Log(ELogCategory::Core, EPrintColor::LightGreen, "Reloaded ", m_vertexPath, " / ", m_fragmentPath);
+    return true;
+}
+
+Shader::PendingProgram Shader::beginBuild(const std::string& vertexCode, const std::string& fragmentCode, bool bRetrievable)
+{
+    const char* vShaderCode = vertexCode.c_str();
+    const char* fShaderCode = fragmentCode.c_str();
+
+    PendingProgram build;
+    build.vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+    glCompileShader(build.vertex);
+
+    build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+    glCompileShader(build.fragment);
+
+    // Linking right away lets the driver do compile and link in one go,
+    // compile errors are reported by finishBuild()
+    build.program = glCreateProgram();
+    if (bRetrievable)
+    {
+        // must be set before linking for glGetProgramBinary to work
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(build.program, build.vertex);
+    glAttachShader(build.program, build.fragment);
+    glLinkProgram(build.program);
+    return build;
+}
+
+bool Shader::isBuildComplete(const PendingProgram& build)
+{
+    if (!GLAD_GL_KHR_parallel_shader_compile)
+    {
+        return true; // the status queries in finishBuild() will wait for the driver
+    }
+    GLint complete = GL_FALSE;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+}
+
+bool Shader::finishBuild(PendingProgram& build)
+{
+    int success;
+    char infoLog[512];
+
+    glGetShaderiv(build.vertex, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(build.vertex, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    glGetShaderiv(build.fragment, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(build.fragment, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(build.program, 512, NULL, infoLog);
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+
+    // shaders are not needed after being compiled and linked
+    glDeleteShader(build.vertex);
+    glDeleteShader(build.fragment);
+    build.vertex = 0;
+    build.fragment = 0;
+    if (!success)
+    {
+        glDeleteProgram(build.program);
+        build.program = 0;
+    }
+    return success;
+}
+
+bool Shader::loadProgramBinary(const std::string& path, uint64_t key)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false; // not cached yet
+    }
+    ProgramBinaryHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != s_programBinaryMagic || header.key != key)
+    {
+        return false;
+    }
+    std::vector<char> binary(header.size);
+    file.read(binary.data(), binary.size());
+    if (!file)
+    {
+        return false;
+    }
+
+    ID = glCreateProgram();
+    glProgramBinary(ID, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint success = 0;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        // the driver may reject binaries even with a matching version string
+        Debug_Log(ELogCategory::Core, EPrintColor::Yellow, "Cached program binary rejected, compiling ", path);
+        glDeleteProgram(ID);
+        ID = 0;
+        return false;
+    }
+    m_bLinked = true;
+    return true;
+}
+
+void Shader::saveProgramBinary(const std::string& path, uint64_t key) const
+{
+    GLint length = 0;
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        return;
+    }
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Could not write program binary ", path);
+        return;
+    }
+    ProgramBinaryHeader header{s_programBinaryMagic, format, key, static_cast<uint32_t>(length)};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+}
+
+// Queries every active uniform once after linking into an open addressing table keyed by name hash
+void Shader::cacheUniformLocations()
+{
+    std::vector<std::pair<uint32_t, GLint>> uniforms;
+    GLint count = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(maxLength, '\0');
+    for (GLint i = 0; i < count; ++i)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, maxLength, &length, &size, &type, name.data());
+        std::string_view uniformName(name.data(), length);
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location == -1)
+        {
+            continue; // uniform block member
+        }
+        uniforms.emplace_back(Hash_Fnv1a_32(uniformName), location);
+
+        // Arrays are reported as "name[0]", register "name" and every element as well
+        if (size > 1 && uniformName.ends_with("[0]"))
+        {
+            std::string baseName(uniformName.substr(0, uniformName.size() - 3));
+            uniforms.emplace_back(Hash_Fnv1a_32(baseName), location);
+            for (GLint element = 1; element < size; ++element)
+            {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                const GLint elementLocation = glGetUniformLocation(ID, elementName.c_str());
+                if (elementLocation != -1) // elements past the last one used can be optimised out
+                {
+                    uniforms.emplace_back(Hash_Fnv1a_32(elementName), elementLocation);
+                }
+            }
+        }
+    }
+
+    // Power of two at least twice the count keeps probe sequences short
+    size_t capacity = 8;
+    while (capacity < uniforms.size() * 2)
+    {
+        capacity *= 2;
+    }
+    m_uniforms.assign(capacity, UniformSlot{0, -1});
+    for (const auto& [hash, location] : uniforms)
+    {
+        size_t i = hash & (capacity - 1);
+        while (m_uniforms[i].location != -1)
+        {
+            if (m_uniforms[i].hash == hash)
+            {
+                std::cerr << "ERROR::SHADER::UNIFORM_HASH_COLLISION" << std::endl;
+            }
+            i = (i + 1) & (capacity - 1);
+        }
+        m_uniforms[i] = UniformSlot{hash, location};
+    }
+}
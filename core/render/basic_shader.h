@@ -3,103 +3,212 @@
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <hash_component.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class FileWatcher;
+
+/*
+ * Uniform name hashed at compile time, "uProjection"_uniform.
+ * Looking it up in a Shader is a single table index, no string or driver call is involved.
+ */
+struct UniformId
+{
+    uint32_t hash;
+};
+
+consteval UniformId operator""_uniform(const char* name, size_t length)
+{
+    return UniformId{Hash_Fnv1a_32(std::string_view(name, length))};
+}
+
+/*
+ * Source code of a program with the defines already injected.
+ * Reading it touches no GL state so it can happen on any thread.
+ */
+struct ShaderSources
+{
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::string defines;
+    std::string vertexCode;
+    std::string fragmentCode;
+    bool bRead{false}; // false if one of the files could not be read
+};
 
+/*
+ * Program made of a vertex and a fragment shader.
+ * The linked program binary is stored in s_binaryCacheDirectory, keyed by the hash of the sources
+ * and the driver, so the next run skips compiling and linking. Any mismatch(new driver, changed source)
+ * simply misses the cache and compiles again.
+ *
+ * With watchSources() the program is rebuilt whenever one of its files changes. The files are read
+ * on the watcher thread, pollHotReload() compiles on the GL thread and swaps the program between frames.
+ * A program that fails to compile or link is dropped and the old one stays in use.
+ *
+ * Constructed from ShaderSources the build does not block: with KHR_parallel_shader_compile the driver
+ * compiles on its own threads while the caller keeps working, pollBuild() checks on it without waiting.
+ * Many shaders started back to back compile concurrently.
+ */
 class Shader
 {
 public:
-    unsigned int ID;
+    unsigned int ID = 0;
 
-    Shader() = default;
+    // Relative to the working directory, like the asset paths
+    inline static std::string s_binaryCacheDirectory = "shader_cache";
 
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader() = default;
+    // defines("#define NAME\n" lines) are inserted right after the #version line of both sources.
+    // Compiles and links before returning.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = "");
+    // Starts compiling and returns right away, see pollBuild()
+    explicit Shader(ShaderSources sources);
+    // Owns its program, deletes it along with a build still in the driver(GL thread only)
+    ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+    Shader(Shader&& other) noexcept;
+    Shader& operator=(Shader&& other) noexcept;
+
+    // Reads both files and injects the defines, safe to call from any thread
+    static ShaderSources readSources(const std::string& vertexPath, const std::string& fragmentPath, const std::string& defines = "");
+    // Copy of sources read without defines with the defines injected, saves reading the files again
+    static ShaderSources withDefines(const ShaderSources& sources, const std::string& defines);
+
+    // Returns true once the build started by the constructor is done(linked or failed), never blocks
+    // when the driver supports KHR_parallel_shader_compile
+    bool pollBuild();
+    // Blocks until the build started by the constructor is done
+    void waitForBuild();
+    bool isBuilt() const
     {
-        // 1. Retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+        return m_build.program == 0;
+    }
 
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    // Starts watching the vertex and fragment files, the watcher must outlive the shader
+    void watchSources(FileWatcher& watcher);
 
-        try
-        {
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
-            vShaderFile.close();
-            fShaderFile.close();
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
+    // Call once per frame on the GL thread, returns true when the program was replaced.
+    // Uniform values belong to the program so the caller has to set them again.
+    bool pollHotReload();
 
-        const char* vShaderCode = vertexCode.c_str();
-        const char* fShaderCode = fragmentCode.c_str();
+    bool isLinked() const
+    {
+        return m_bLinked;
+    }
 
-        // 2. Compile shaders
-        unsigned int vertex, fragment;
-        int success;
-        char infoLog[512];
+    void use() const
+    {
+        glUseProgram(ID);
+    }
 
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-        if (!success)
+    // Location of an active uniform, -1 if the program has no such uniform(glUniform* ignores -1)
+    GLint getUniformLocation(UniformId id) const
+    {
+        if (m_uniforms.empty())
         {
-            glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-            std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+            return -1;
         }
-
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-        if (!success)
+        // the table always has empty slots so the probe ends
+        const size_t mask = m_uniforms.size() - 1;
+        size_t i = id.hash & mask;
+        while (m_uniforms[i].location != -1 && m_uniforms[i].hash != id.hash)
         {
-            glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-            std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+            i = (i + 1) & mask;
         }
+        return m_uniforms[i].location;
+    }
 
-        // 3. Link shaders into a program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        glGetProgramiv(ID, GL_LINK_STATUS, &success);
-        if (!success)
-        {
-            glGetProgramInfoLog(ID, 512, NULL, infoLog);
-            std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-        }
+    void setInt(UniformId id, int value) const
+    {
+        glUniform1i(getUniformLocation(id), value);
+    }
+
+    void setFloat(UniformId id, float value) const
+    {
+        glUniform1f(getUniformLocation(id), value);
+    }
 
-        // shaders are not needed after being compiled and linked
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+    void setVec2(UniformId id, const glm::vec2& value) const
+    {
+        glUniform2f(getUniformLocation(id), value.x, value.y);
     }
 
-    void use() const
+    void setVec3(UniformId id, const glm::vec3& value) const
     {
-        glUseProgram(ID);
+        glUniform3f(getUniformLocation(id), value.x, value.y, value.z);
     }
 
-    void setInt(const std::string& name, int value) const
+    void setMat4(UniformId id, const glm::mat4& mat) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniformMatrix4fv(getUniformLocation(id), 1, GL_FALSE, glm::value_ptr(mat));
     }
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const
+    // Names only known at runtime are hashed on the call but still served from the cache
+    void setInt(std::string_view name, int value) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+        setInt(UniformId{Hash_Fnv1a_32(name)}, value);
     }
-};
 
+    void setMat4(std::string_view name, const glm::mat4& mat) const
+    {
+        setMat4(UniformId{Hash_Fnv1a_32(name)}, mat);
+    }
+
+private:
+    struct UniformSlot
+    {
+        uint32_t hash;
+        GLint location; // -1 marks an empty slot
+    };
+
+    // Shader and program objects of a build that may still be compiling in the driver
+    struct PendingProgram
+    {
+        unsigned int program{0};
+        unsigned int vertex{0};
+        unsigned int fragment{0};
+    };
+
+    // Sources read by the watcher thread and the rebuild they trigger on the GL thread
+    struct HotReloadState
+    {
+        std::mutex mutex;
+        std::string vertexCode;
+        std::string fragmentCode;
+        bool bPending{false};
+        PendingProgram build;
+        uint64_t key{0};
+    };
+
+    static PendingProgram beginBuild(const std::string& vertexCode, const std::string& fragmentCode, bool bRetrievable);
+    // Never blocks when the driver supports KHR_parallel_shader_compile, otherwise always true
+    static bool isBuildComplete(const PendingProgram& build);
+    // Logs errors and releases the shader objects, the program is deleted if linking failed
+    static bool finishBuild(PendingProgram& build);
+    bool loadProgramBinary(const std::string& path, uint64_t key);
+    void saveProgramBinary(const std::string& path, uint64_t key) const;
+    void cacheUniformLocations();
+
+    // Links the build into ID and stores the binary, the build must be complete
+    void completeBuild();
+    // Deletes the program and the shader and program objects of unfinished builds
+    void release();
+
+    bool m_bLinked = false;
+    // initial build still running in the driver, program is 0 once it is done
+    PendingProgram m_build;
+    uint64_t m_binaryKey = 0;
+    std::vector<UniformSlot> m_uniforms;
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::string m_defines;
+    // shared so the watcher callback stays valid when the Shader is moved
+    std::shared_ptr<HotReloadState> m_hotReload;
+};
@@ -1,6 +1,13 @@
 #include "basic_texture.h"
+#include "pixel_upload_ring.h"
+#include "cooked_texture.h"
+#include "png_decoder.h"
 
 #include <stb_image.h>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 
 Texture::Texture(const std::string& path)
@@ -13,72 +20,422 @@ Texture::Texture(const std::string& path)
     }
 }
 
-Texture::~Texture()
+Texture::Texture(const std::string& path, DecodedImage image)
+    : ID(0), width(0), height(0), nrChannels(0), filePath(path)
 {
-    // Delete the OpenGL texture
-    glDeleteTextures(1, &ID);
+    if (!upload(image))
+    {
+        std::cerr << "Failed to load texture from file: " << path << std::endl;
+    }
 }
 
-bool Texture::loadFromFile(const std::string& path)
+Texture::Texture(const std::string& path, unsigned int placeholderID)
+    : ID(placeholderID), width(0), height(0), nrChannels(0), filePath(path)
 {
-    // Generate the texture object in OpenGL
-    glGenTextures(1, &ID);
+}
 
-    // Load the image data using stb_image
-    stbi_set_flip_vertically_on_load(true); // Flip the image vertically
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+Texture::Texture(const std::string& name, int width, int height, const void* rgbaPixels, int maxLevel)
+    : ID(0), width(width), height(height), nrChannels(4), filePath(name)
+{
+    if (s_bCpuOnly)
+    {
+        pixels.resize(static_cast<size_t>(width) * height);
+        std::memcpy(pixels.data(), rgbaPixels, pixels.size() * sizeof(uint32_t));
+        m_byteSize = pixels.size() * sizeof(uint32_t);
+    }
+    else
+    {
+        // Same filtering as decoded images, rows of RGBA8 are always 4 byte aligned
+        std::vector<MipLevel> mips = Generate_Mip_Chain(static_cast<const uint8_t*>(rgbaPixels), width, height, 4);
+        if (maxLevel >= 0 && mips.size() > static_cast<size_t>(maxLevel))
+        {
+            mips.resize(maxLevel);
+        }
+        createObject();
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.size()));
+        m_levelsCount = static_cast<int>(mips.size()) + 1;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgbaPixels);
+        m_byteSize = static_cast<size_t>(width) * height * 4;
+        for (size_t level = 1; level <= mips.size(); ++level)
+        {
+            const MipLevel& mip = mips[level - 1];
+            glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), GL_RGBA, mip.width, mip.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, mip.pixels.data());
+            m_byteSize += mip.pixels.size();
+        }
+    }
+    m_bResident = true;
+}
 
-    if (data)
+Texture::Texture(const std::string& name, int width, int height, uint32_t clearColor)
+    : ID(0), width(width), height(height), nrChannels(4), filePath(name)
+{
+    pixels.assign(static_cast<size_t>(width) * height, clearColor);
+    m_byteSize = pixels.size() * sizeof(uint32_t);
+    m_bResident = true;
+    if (s_bCpuOnly)
     {
-        GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
+        return;
+    }
+    createObject();
+    // Only level 0 changes, mips would have to be rebuilt on every update
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+}
 
-        // Bind the texture
-        glBindTexture(GL_TEXTURE_2D, ID);
+static GLenum Compressed_Internal_Format(ECookedFormat format)
+{
+    switch (format)
+    {
+        case ECookedFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case ECookedFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        default:                 return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+}
 
-        // Set texture parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+Texture::Texture(const std::string& path, const CookedTexture& cooked)
+    : ID(0), width(0), height(0), nrChannels(0), filePath(path)
+{
+    upload(cooked);
+}
 
-        // Upload the texture data to the GPU
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+bool Texture::upload(const CookedTexture& cooked, int baseLevel)
+{
+    width = cooked.getWidth();
+    height = cooked.getHeight();
+    nrChannels = CookedTexture::channelsOf(cooked.getFormat());
+    m_bCooked = true;
+    m_byteSize = 0;
+    if (s_bCpuOnly)
+    {
+        // The rasterizer wants RGBA8 level 0
+        const CookedMip base = cooked.getMip(0);
+        pixels.resize(static_cast<size_t>(width) * height);
+        for (size_t i = 0; i < pixels.size(); ++i)
+        {
+            const uint8_t* texel = base.data + i * nrChannels;
+            pixels[i] = texel[0] | (texel[1] << 8) | (texel[2] << 16) | (nrChannels == 4 ? (static_cast<uint32_t>(texel[3]) << 24) : 0xFF000000u);
+        }
+        m_byteSize = pixels.size() * sizeof(uint32_t);
+        m_bResident = true;
+        return true;
+    }
 
-        // Generate mipmaps
-        glGenerateMipmap(GL_TEXTURE_2D);
+    // Reloaded after an eviction, a resident texture is replaced
+    const unsigned int previousID = (m_bResident && !isSubTexture()) ? ID : 0;
+    baseLevel = std::clamp(baseLevel, 0, static_cast<int>(cooked.getMipCount()) - 1);
+    createObject();
+    // Levels below the base are never sampled and can stay undefined, the texture is complete without them
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(cooked.getMipCount() - 1));
+    m_levelsCount = static_cast<int>(cooked.getMipCount());
+    m_baseLevel = baseLevel;
+    if (previousID != 0)
+    {
+        glDeleteTextures(1, &previousID);
+    }
+    if (CookedTexture::isCompressed(cooked.getFormat()))
+    {
+        // The blocks go to the GPU as they are, 4-8x less to upload and to keep in VRAM
+        const GLenum internalFormat = Compressed_Internal_Format(cooked.getFormat());
+        for (uint32_t level = baseLevel; level < cooked.getMipCount(); ++level)
+        {
+            const CookedMip mip = cooked.getMip(level);
+            glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, mip.width, mip.height, 0, static_cast<GLsizei>(mip.size), mip.data);
+            m_byteSize += mip.size;
+        }
+        m_bResident = true;
+        return true;
+    }
 
-        // Free the image data after uploading it to the GPU
-        stbi_image_free(data);
+    GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB rows are tightly packed
+    for (uint32_t level = baseLevel; level < cooked.getMipCount(); ++level)
+    {
+        const CookedMip mip = cooked.getMip(level);
+        glTexImage2D(GL_TEXTURE_2D, level, format, mip.width, mip.height, 0, format, GL_UNSIGNED_BYTE, mip.data);
+        m_byteSize += mip.size;
     }
-    else
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_bResident = true;
+    return true;
+}
+
+bool Texture::supportsCookedFormat(ECookedFormat format)
+{
+    switch (format)
+    {
+        case ECookedFormat::RGB8:
+        case ECookedFormat::RGBA8:
+            return true;
+        case ECookedFormat::BC1:
+        case ECookedFormat::BC3:
+            return !s_bCpuOnly && GLAD_GL_EXT_texture_compression_s3tc;
+        case ECookedFormat::BC7:
+            return !s_bCpuOnly && (GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_compression_bptc);
+    }
+    return false;
+}
+
+Texture::Texture(const std::string& path, std::shared_ptr<Texture> atlasPage, const glm::vec2& uvMin, const glm::vec2& uvMax, int width, int height)
+    : ID(atlasPage->ID), width(width), height(height), nrChannels(4), filePath(path), uvMin(uvMin), uvMax(uvMax),
+      m_bResident(true), m_atlasPage(std::move(atlasPage))
+{
+}
+
+Texture::~Texture()
+{
+    // Delete the OpenGL texture, the placeholder belongs to whoever created it and the atlas page to the page
+    if (!s_bCpuOnly && m_bResident && !m_atlasPage)
+    {
+        glDeleteTextures(1, &ID);
+    }
+}
+
+void DecodedPixelsDeleter::operator()(unsigned char* data) const
+{
+    // Png_Load and stb_image(STBI_FREE) both allocate with malloc
+    std::free(data);
+}
+
+// Grey to RGB, grey+alpha to RGBA: uploads are GL_RGB or GL_RGBA(same as cherry_cook does)
+static void Expand_Grey(DecodedImage& image)
+{
+    const int channels = image.nrChannels + 2;
+    const size_t count = static_cast<size_t>(image.width) * image.height;
+    unsigned char* expanded = static_cast<unsigned char*>(std::malloc(count * channels));
+    if (!expanded)
+    {
+        image.data.reset();
+        return;
+    }
+    const unsigned char* source = image.data.get();
+    for (size_t i = 0; i < count; ++i)
+    {
+        unsigned char* texel = expanded + i * channels;
+        texel[0] = texel[1] = texel[2] = source[i * image.nrChannels];
+        if (channels == 4)
+        {
+            texel[3] = source[i * 2 + 1];
+        }
+    }
+    image.data.reset(expanded);
+    image.nrChannels = channels;
+}
+
+DecodedImage Texture::decode(const std::string& path, const MipOptions& mipOptions)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    std::vector<uint8_t> bytes(file ? static_cast<size_t>(file.tellg()) : 0);
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(bytes.data()), bytes.size()) || bytes.empty())
+    {
+        std::cerr << "Texture failed to load at path: " << path << std::endl;
+        return DecodedImage{};
+    }
+    DecodedImage image = decode(bytes.data(), bytes.size(), mipOptions);
+    if (!image.data)
     {
         std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+    }
+    return image;
+}
+
+DecodedImage Texture::decode(const uint8_t* file, size_t size, const MipOptions& mipOptions)
+{
+    DecodedImage image;
+    // Always expand to RGBA in CPU only mode so the rasterizer can copy whole texels
+    const int desiredChannels = s_bCpuOnly ? 4 : 0;
+    // Flipped vertically for OpenGL
+    image.data.reset(Png_Load(file, size, &image.width, &image.height, &image.nrChannels, desiredChannels, true));
+    if (!image.data)
+    {
+        // Every other format and the PNGs Png_Load does not handle
+        // The flip flag is per thread, decode() may run on several workers at once
+        stbi_set_flip_vertically_on_load_thread(true);
+        image.data.reset(stbi_load_from_memory(file, static_cast<int>(size), &image.width, &image.height, &image.nrChannels, desiredChannels));
+    }
+    if (!image.data)
+    {
+        return image;
+    }
+    if (desiredChannels != 0)
+    {
+        image.nrChannels = desiredChannels; // nrChannels is what the file has, the pixels were converted
+    }
+    else if (image.nrChannels == 1 || image.nrChannels == 2)
+    {
+        Expand_Grey(image);
+    }
+    // The rasterizer samples level 0 only
+    if (!s_bCpuOnly)
+    {
+        image.mips = Generate_Mip_Chain(image.data.get(), image.width, image.height, image.nrChannels, mipOptions);
+    }
+    return image;
+}
+
+bool Texture::loadFromFile(const std::string& path)
+{
+    DecodedImage image = decode(path);
+    return upload(image);
+}
+
+bool Texture::upload(DecodedImage& image)
+{
+    if (!image.data)
+    {
         return false;
     }
+    width = image.width;
+    height = image.height;
+    nrChannels = image.nrChannels;
+    m_bCooked = false;
 
+    if (s_bCpuOnly)
+    {
+        pixels.resize(static_cast<size_t>(width) * height);
+        std::memcpy(pixels.data(), image.data.get(), pixels.size() * sizeof(uint32_t));
+        image.data.reset();
+        m_byteSize = pixels.size() * sizeof(uint32_t);
+        m_bResident = true;
+        return true;
+    }
+
+    createObject();
+    allocateLevels(image, 0);
+
+    // Upload the texture data to the GPU, the mips were generated by decode()
+    std::vector<const void*> levels{image.data.get()};
+    for (const MipLevel& mip : image.mips)
+    {
+        levels.push_back(mip.pixels.data());
+    }
+    uploadLevels(image, 0, levels);
+
+    // Free the image data after uploading it to the GPU
+    image.data.reset();
+    image.mips.clear();
+    m_bResident = true;
     return true;
 }
 
-void Texture::bind(unsigned int unit) const
+bool Texture::upload(PixelUploadRing& ring, int slot, DecodedImage& image, int baseLevel)
 {
-    // Activate the texture unit before binding
-    glActiveTexture(GL_TEXTURE0 + unit);
-    glBindTexture(GL_TEXTURE_2D, ID);
+    // A resident texture is being restreamed with other levels, it keeps drawing the old ones until now
+    const unsigned int previousID = (m_bResident && !isSubTexture()) ? ID : 0;
+    width = image.width;
+    height = image.height;
+    nrChannels = image.nrChannels;
+    m_bCooked = false;
+    baseLevel = std::clamp(baseLevel, 0, static_cast<int>(image.mips.size()));
+
+    createObject();
+    // before the slot is bound, a null pointer would be offset 0 into it
+    allocateLevels(image, baseLevel);
+    // With a pixel unpack buffer bound the data pointers are offsets into it and the calls do not wait for the copy.
+    // The slot holds the levels from baseLevel on.
+    std::vector<const void*> levels(static_cast<size_t>(baseLevel), nullptr);
+    size_t offset = 0;
+    for (size_t level = baseLevel; level <= image.mips.size(); ++level)
+    {
+        levels.push_back(reinterpret_cast<const void*>(offset));
+        const int levelWidth = level == 0 ? width : image.mips[level - 1].width;
+        const int levelHeight = level == 0 ? height : image.mips[level - 1].height;
+        offset += static_cast<size_t>(levelWidth) * levelHeight * nrChannels;
+    }
+    ring.bindForUpload(slot);
+    uploadLevels(image, baseLevel, levels);
+    ring.finishUpload(slot);
+    if (previousID != 0)
+    {
+        glDeleteTextures(1, &previousID);
+    }
+
+    image.data.reset();
+    image.mips.clear();
+    m_bResident = true;
+    return true;
+}
+
+void Texture::allocateLevels(const DecodedImage& image, int baseLevel)
+{
+    GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
+    // Levels below the base are never sampled and can stay undefined, the texture is complete without them
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, baseLevel);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(image.mips.size()));
+    for (size_t level = baseLevel; level <= image.mips.size(); ++level)
+    {
+        const int levelWidth = level == 0 ? image.width : image.mips[level - 1].width;
+        const int levelHeight = level == 0 ? image.height : image.mips[level - 1].height;
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), format, levelWidth, levelHeight, 0, format, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+void Texture::uploadLevels(const DecodedImage& image, int baseLevel, const std::vector<const void*>& levels)
+{
+    GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB rows and odd sized mips are tightly packed
+    m_byteSize = 0;
+    for (size_t level = baseLevel; level < levels.size(); ++level)
+    {
+        const int levelWidth = level == 0 ? image.width : image.mips[level - 1].width;
+        const int levelHeight = level == 0 ? image.height : image.mips[level - 1].height;
+        glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), 0, 0, levelWidth, levelHeight, format, GL_UNSIGNED_BYTE, levels[level]);
+        m_byteSize += static_cast<size_t>(levelWidth) * levelHeight * nrChannels;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    m_baseLevel = baseLevel;
+    m_levelsCount = static_cast<int>(image.mips.size()) + 1;
 }
 
-void Texture::generate()
+void Texture::createObject()
 {
-    // This method is optional. It's typically used when generating a blank texture or for procedural textures.
+    // Generate the texture object in OpenGL and bind it
     glGenTextures(1, &ID);
     glBindTexture(GL_TEXTURE_2D, ID);
 
-    // Allocate space for the texture, this can be useful if you plan on dynamically filling it later
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-
-    // Set texture parameters here as well
+    // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
+
+void Texture::evict(unsigned int placeholderID)
+{
+    if (!m_bResident || isSubTexture())
+    {
+        return;
+    }
+    if (s_bCpuOnly)
+    {
+        pixels = std::vector<uint32_t>();
+    }
+    else
+    {
+        glDeleteTextures(1, &ID);
+    }
+    ID = placeholderID;
+    m_byteSize = 0;
+    m_bResident = false;
+}
+
+void Texture::markUsed(float screenScale) const
+{
+    if (m_lastUsedFrame != s_currentFrame)
+    {
+        m_lastUsedFrame = s_currentFrame;
+        m_screenScale = screenScale;
+        return;
+    }
+    m_screenScale = std::max(m_screenScale, screenScale);
+}
+
+void Texture::bind(unsigned int unit) const
+{
+    markUsed();
+    // Activate the texture unit before binding
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, ID);
+}
@@ -1,7 +1,36 @@
 #pragma once
 
+#include "mip_generator.h"
+
 #include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+
+class PixelUploadRing;
+class CookedTexture;
+enum class ECookedFormat : uint32_t;
+
+/* Frees pixels allocated by Png_Load or stb_image */
+struct DecodedPixelsDeleter
+{
+    void operator()(unsigned char* data) const;
+};
+
+/*
+ * Image decoded from a file, not yet uploaded.
+ * Decoding touches no GL state so it can run on any thread, the upload must happen on the GL thread.
+ */
+struct DecodedImage
+{
+    int width{0};
+    int height{0};
+    int nrChannels{0};
+    std::unique_ptr<unsigned char, DecodedPixelsDeleter> data;
+    std::vector<MipLevel> mips; // level 1 and below, generated with the decode so the GL thread does not have to
+};
 
 class Texture
 {
@@ -10,15 +39,101 @@ public:
     int width, height;         // Texture dimensions
     int nrChannels;            // Number of channels (RGB/RGBA)
     std::string filePath;      // Path to the texture file
+    std::vector<uint32_t> pixels; // RGBA8 copy in RAM, only kept in CPU only mode and by DynamicTexture
+    glm::vec2 uvMin{0.0f, 0.0f};  // Area of ID the texture covers, smaller than the whole for atlas sub textures
+    glm::vec2 uvMax{1.0f, 1.0f};
+
+    // Set before loading when rendering with the SoftwareRasterizer.
+    // Textures then keep their pixels in RAM and never touch OpenGL(there may be no context at all).
+    inline static bool s_bCpuOnly = false;
+    // Advanced once per frame by the ResourceManager, stamped on textures when they are used
+    inline static uint64_t s_currentFrame = 0;
 
     // Constructor to load and create a texture from a file
     Texture(const std::string& path);
+    // Uploads an image decoded earlier(on another thread for example) with decode()
+    Texture(const std::string& path, DecodedImage image);
+    // Not loaded yet, ID is placeholderID until upload() makes the texture resident(see TextureStreamer)
+    Texture(const std::string& path, unsigned int placeholderID);
+    // Uploads width x height RGBA8 pixels(bottom row first), the mips are generated on the calling thread.
+    // maxLevel limits the chain(the levels 1 to maxLevel), -1 for all of them.
+    Texture(const std::string& name, int width, int height, const void* rgbaPixels, int maxLevel = -1);
+    // Uploads every stored level of a cooked texture as is, no decoding or mipmap generation.
+    // Check supportsCookedFormat() first, block compressed formats depend on the driver.
+    Texture(const std::string& path, const CookedTexture& cooked);
+    // Area of an atlas page, shares the GL texture of the page and keeps the page alive
+    Texture(const std::string& path, std::shared_ptr<Texture> atlasPage, const glm::vec2& uvMin, const glm::vec2& uvMax, int width, int height);
     ~Texture();
 
+    // GL thread only, whether a cooked texture of this format can be uploaded
+    static bool supportsCookedFormat(ECookedFormat format);
+
+    // Decodes the file flipped vertically and builds its mip chain, thread safe. data is null if the file could not be decoded.
+    static DecodedImage decode(const std::string& path, const MipOptions& mipOptions = {});
+    // Same for a whole image file already in memory(an AssetPack blob for example), logs nothing on failure
+    static DecodedImage decode(const uint8_t* file, size_t size, const MipOptions& mipOptions = {});
+
+    // GL thread only(unless s_bCpuOnly), consumes the pixels and makes the texture resident
+    bool upload(DecodedImage& image);
+    // GL thread only, the levels of the image from baseLevel on(tightly packed rows, finest first) were copied into
+    // a mapped slot of the ring. Returns before the driver has read them, the ring fences the slot. Consumes the pixels.
+    // A resident texture is replaced, the finer levels below baseLevel are not kept in memory.
+    bool upload(PixelUploadRing& ring, int slot, DecodedImage& image, int baseLevel = 0);
+    // GL thread only(unless s_bCpuOnly), uploads the stored levels of a cooked texture from baseLevel on as they are,
+    // a resident texture is replaced. Check supportsCookedFormat() first.
+    bool upload(const CookedTexture& cooked, int baseLevel = 0);
+
+    // Whether the levels came from a cooked texture, they are then reloaded from it instead of decoding filePath
+    bool isCooked() const { return m_bCooked; }
+
+    // false while the texture still shows its placeholder
+    bool isResident() const { return m_bResident; }
+
+    // Atlas sub textures share the GL texture of their page
+    bool isSubTexture() const { return m_atlasPage != nullptr; }
+
+    // GL thread only. Frees the texture memory(see TextureBudget), the texture shows placeholderID until uploaded again
+    void evict(unsigned int placeholderID);
+
+    // Texture memory owned by the texture, 0 for atlas sub textures(the page owns it) and while not resident
+    size_t getByteSize() const { return m_byteSize; }
+
+    // Stamps the current frame, done by bind() and Renderer2D::drawQuad().
+    // screenScale is the on-screen pixels per texel of the draw, the largest one of the frame is kept.
+    void markUsed(float screenScale = 1.0f) const;
+    uint64_t getLastUsedFrame() const { return m_lastUsedFrame; }
+    // Largest screenScale of the frame the texture was last used in
+    float getScreenScale() const { return m_screenScale; }
+
+    // Finest mip level in memory(GL_TEXTURE_BASE_LEVEL) and the number of levels of the full chain
+    int getBaseLevel() const { return m_baseLevel; }
+    int getLevelsCount() const { return m_levelsCount; }
+
     // Binds the texture
     void bind(unsigned int unit = 0) const;
 
+protected:
+    // width x height RGBA8 texture filled with clearColor, a single level(see DynamicTexture)
+    Texture(const std::string& name, int width, int height, uint32_t clearColor);
+
 private:
     bool loadFromFile(const std::string& path);
-    void generate();
+    // Creates and binds the GL texture with the default sampling parameters
+    void createObject();
+    // Allocates the levels of the image from baseLevel on in the newly created texture, without pixels.
+    // Once per texture object, a restream creates a new one. No pixel unpack buffer may be bound.
+    void allocateLevels(const DecodedImage& image, int baseLevel);
+    // Fills the allocated levels from baseLevel on with glTexSubImage2D, levels[i] points to the pixels
+    // of level i(or is an offset into the bound pixel unpack buffer)
+    void uploadLevels(const DecodedImage& image, int baseLevel, const std::vector<const void*>& levels);
+
+    bool m_bResident = false;
+    bool m_bCooked = false;
+    size_t m_byteSize = 0;
+    int m_baseLevel = 0;
+    int m_levelsCount = 1;
+    mutable uint64_t m_lastUsedFrame = 0;
+    mutable float m_screenScale = 1.0f;
+    // set for atlas sub textures, the page owns ID
+    std::shared_ptr<Texture> m_atlasPage;
 };
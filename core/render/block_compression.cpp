@@ -0,0 +1,405 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Principal axis of count points with dimensions components each(3 for RGB, 4 for RGBA),
+// the endpoints are the extremes of the points projected on it
+template<int dimensions>
+static void Fit_Principal_Axis(const float points[][4], int count, float start[4], float end[4])
+{
+    float mean[4] = {};
+    for (int i = 0; i < count; ++i)
+    {
+        for (int c = 0; c < dimensions; ++c) { mean[c] += points[i][c]; }
+    }
+    for (int c = 0; c < dimensions; ++c) { mean[c] /= count; }
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < count; ++i)
+    {
+        for (int a = 0; a < dimensions; ++a)
+        {
+            for (int b = 0; b < dimensions; ++b)
+            {
+                covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // Power iteration converges to the dominant eigenvector within a few steps for 4x4 blocks.
+    // It starts from the covariance column of the channel that varies most: a fixed start like (1,1,1) fails
+    // for variation orthogonal to it(a red/green checker varies along (1,-1,0)) and the block came out flat.
+    int widest = 0;
+    float trace = 0.0f;
+    for (int c = 0; c < dimensions; ++c)
+    {
+        trace += covariance[c][c];
+        widest = covariance[c][c] > covariance[widest][widest] ? c : widest;
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    if (trace > 0.0f)
+    {
+        for (int c = 0; c < dimensions; ++c) { axis[c] = covariance[c][widest]; }
+    }
+    // else every point is the same color, any axis works
+    for (int iteration = 0; trace > 0.0f && iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        for (int a = 0; a < dimensions; ++a)
+        {
+            for (int b = 0; b < dimensions; ++b) { next[a] += covariance[a][b] * axis[b]; }
+        }
+        float length = 0.0f;
+        for (int c = 0; c < dimensions; ++c) { length = std::max(length, std::fabs(next[c])); }
+        if (length < 1e-6f)
+        {
+            break; // keeps the last axis, the start is never orthogonal to all of the variation
+        }
+        for (int c = 0; c < dimensions; ++c) { axis[c] = next[c] / length; }
+    }
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    float lengthSquared = 0.0f;
+    for (int c = 0; c < dimensions; ++c) { lengthSquared += axis[c] * axis[c]; }
+    for (int i = 0; i < count; ++i)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < dimensions; ++c) { t += (points[i][c] - mean[c]) * axis[c]; }
+        t /= lengthSquared;
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < dimensions; ++c)
+    {
+        start[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+        end[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+    }
+}
+
+static uint16_t Pack_565(const float color[4])
+{
+    const uint16_t r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    const uint16_t g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    const uint16_t b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void Unpack_565(uint16_t packed, int color[3])
+{
+    const int r = (packed >> 11) & 31;
+    const int g = (packed >> 5) & 63;
+    const int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Picks the closest of the 4 palette colors for every pixel, returns the total squared error
+static uint32_t Choose_Color_Indices(const float points[][4], uint16_t color0, uint16_t color1, uint32_t& indices)
+{
+    int palette[4][3];
+    Unpack_565(color0, palette[0]);
+    Unpack_565(color1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    indices = 0;
+    uint32_t totalError = 0;
+    for (int i = 0; i < 16; ++i)
+    {
+        uint32_t bestError = UINT32_MAX;
+        uint32_t best = 0;
+        for (uint32_t index = 0; index < 4; ++index)
+        {
+            uint32_t error = 0;
+            for (int c = 0; c < 3; ++c)
+            {
+                const int difference = static_cast<int>(points[i][c]) - palette[index][c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = index;
+            }
+        }
+        indices |= best << (i * 2);
+        totalError += bestError;
+    }
+    return totalError;
+}
+
+// Encodes the RGB part of a block in 4 color mode
+static void Encode_Color_Block(const float points[][4], uint8_t output[8])
+{
+    float start[4];
+    float end[4];
+    Fit_Principal_Axis<3>(points, 16, start, end);
+    uint16_t color0 = Pack_565(start);
+    uint16_t color1 = Pack_565(end);
+
+    uint32_t indices = 0;
+    uint32_t error = Choose_Color_Indices(points, color0, color1, indices);
+
+    // One least squares pass moves the endpoints to where the chosen indices want them
+    static constexpr float s_weights[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[3] = {}, bx[3] = {};
+    for (int i = 0; i < 16; ++i)
+    {
+        const float a = s_weights[(indices >> (i * 2)) & 3];
+        const float b = 1.0f - a;
+        aa += a * a; bb += b * b; ab += a * b;
+        for (int c = 0; c < 3; ++c) { ax[c] += a * points[i][c]; bx[c] += b * points[i][c]; }
+    }
+    const float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) > 1e-6f)
+    {
+        float refinedStart[4];
+        float refinedEnd[4];
+        for (int c = 0; c < 3; ++c)
+        {
+            refinedStart[c] = std::clamp((ax[c] * bb - bx[c] * ab) / determinant, 0.0f, 255.0f);
+            refinedEnd[c] = std::clamp((bx[c] * aa - ax[c] * ab) / determinant, 0.0f, 255.0f);
+        }
+        const uint16_t refined0 = Pack_565(refinedStart);
+        const uint16_t refined1 = Pack_565(refinedEnd);
+        uint32_t refinedIndices = 0;
+        const uint32_t refinedError = Choose_Color_Indices(points, refined0, refined1, refinedIndices);
+        if (refinedError < error)
+        {
+            color0 = refined0;
+            color1 = refined1;
+            indices = refinedIndices;
+        }
+    }
+
+    // color0 > color1 selects the 4 color mode in BC1, swapping the endpoints swaps indices 0<->1 and 2<->3
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+        indices ^= 0x55555555u;
+    }
+    else if (color0 == color1)
+    {
+        indices = 0; // 3 color mode, index 0 is still color0
+    }
+    output[0] = static_cast<uint8_t>(color0);
+    output[1] = static_cast<uint8_t>(color0 >> 8);
+    output[2] = static_cast<uint8_t>(color1);
+    output[3] = static_cast<uint8_t>(color1 >> 8);
+    std::memcpy(output + 4, &indices, 4); // little endian
+}
+
+static void Load_Points(const uint8_t block[64], float points[16][4])
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        for (int c = 0; c < 4; ++c) { points[i][c] = block[i * 4 + c]; }
+    }
+}
+
+void Encode_Block_BC1(const uint8_t block[64], uint8_t output[8])
+{
+    float points[16][4];
+    Load_Points(block, points);
+    Encode_Color_Block(points, output);
+}
+
+void Encode_Block_BC3(const uint8_t block[64], uint8_t output[16])
+{
+    // Alpha block: a0 > a1 gives 6 interpolated values between them
+    uint8_t alpha0 = 0;
+    uint8_t alpha1 = 255;
+    for (int i = 0; i < 16; ++i)
+    {
+        alpha0 = std::max(alpha0, block[i * 4 + 3]);
+        alpha1 = std::min(alpha1, block[i * 4 + 3]);
+    }
+    uint64_t alphaIndices = 0;
+    if (alpha0 != alpha1)
+    {
+        int palette[8] = {alpha0, alpha1};
+        for (int k = 1; k <= 6; ++k)
+        {
+            palette[k + 1] = ((7 - k) * alpha0 + k * alpha1) / 7;
+        }
+        for (int i = 0; i < 16; ++i)
+        {
+            int bestError = 256;
+            uint64_t best = 0;
+            for (int index = 0; index < 8; ++index)
+            {
+                const int error = std::abs(block[i * 4 + 3] - palette[index]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    best = index;
+                }
+            }
+            alphaIndices |= best << (i * 3);
+        }
+    }
+    output[0] = alpha0;
+    output[1] = alpha1;
+    for (int byte = 0; byte < 6; ++byte)
+    {
+        output[2 + byte] = static_cast<uint8_t>(alphaIndices >> (byte * 8));
+    }
+
+    float points[16][4];
+    Load_Points(block, points);
+    Encode_Color_Block(points, output + 8);
+}
+
+// Writes bits into a 128 bit block, least significant bit first
+struct BlockBitWriter
+{
+    uint8_t* output;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t bits)
+    {
+        for (uint32_t bit = 0; bit < bits; ++bit, ++position)
+        {
+            if (value & (1u << bit))
+            {
+                output[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+            }
+        }
+    }
+};
+
+// Quantizes an endpoint to 7 bits per channel plus a shared p-bit, picking the p-bit with less error
+static void Quantize_BC7_Endpoint(const float endpoint[4], uint8_t quantized[4], uint8_t& pBit)
+{
+    float bestError = 1e30f;
+    for (uint8_t p = 0; p < 2; ++p)
+    {
+        uint8_t candidate[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; ++c)
+        {
+            const long q = std::clamp(std::lround((endpoint[c] - p) * 0.5f), 0l, 127l);
+            candidate[c] = static_cast<uint8_t>(q);
+            const float difference = static_cast<float>((q << 1) | p) - endpoint[c];
+            error += difference * difference;
+        }
+        if (error < bestError)
+        {
+            bestError = error;
+            std::memcpy(quantized, candidate, 4);
+            pBit = p;
+        }
+    }
+}
+
+void Encode_Block_BC7(const uint8_t block[64], uint8_t output[16])
+{
+    static constexpr int s_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+    float points[16][4];
+    Load_Points(block, points);
+    float start[4];
+    float end[4];
+    Fit_Principal_Axis<4>(points, 16, start, end);
+
+    uint8_t endpoints[2][4];
+    uint8_t pBits[2];
+    Quantize_BC7_Endpoint(start, endpoints[0], pBits[0]);
+    Quantize_BC7_Endpoint(end, endpoints[1], pBits[1]);
+
+    // Palette exactly as the decoder interpolates it
+    int palette[16][4];
+    for (int index = 0; index < 16; ++index)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            const int e0 = (endpoints[0][c] << 1) | pBits[0];
+            const int e1 = (endpoints[1][c] << 1) | pBits[1];
+            palette[index][c] = ((64 - s_weights[index]) * e0 + s_weights[index] * e1 + 32) >> 6;
+        }
+    }
+    uint8_t indices[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        int bestError = INT32_MAX;
+        for (int index = 0; index < 16; ++index)
+        {
+            int error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                const int difference = block[i * 4 + c] - palette[index][c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                indices[i] = static_cast<uint8_t>(index);
+            }
+        }
+    }
+
+    // The most significant bit of the first index is implied 0, swap the endpoints if it would be 1
+    if (indices[0] & 8)
+    {
+        std::swap(endpoints[0], endpoints[1]);
+        std::swap(pBits[0], pBits[1]);
+        for (uint8_t& index : indices) { index = static_cast<uint8_t>(15 - index); }
+    }
+
+    std::memset(output, 0, 16);
+    BlockBitWriter writer{output};
+    writer.write(1u << 6, 7); // mode 6
+    for (int c = 0; c < 4; ++c)
+    {
+        writer.write(endpoints[0][c], 7);
+        writer.write(endpoints[1][c], 7);
+    }
+    writer.write(pBits[0], 1);
+    writer.write(pBits[1], 1);
+    writer.write(indices[0], 3);
+    for (int i = 1; i < 16; ++i)
+    {
+        writer.write(indices[i], 4);
+    }
+}
+
+std::vector<uint8_t> Compress_Blocks(const uint8_t* rgba, int width, int height, EBlockFormat format)
+{
+    const int blocksX = (width + 3) / 4;
+    const int blocksY = (height + 3) / 4;
+    const size_t blockSize = Block_Size(format);
+    std::vector<uint8_t> output(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+    uint8_t block[64];
+    for (int blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for (int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            // Partial blocks repeat the last row/column so they do not pull the endpoints off
+            for (int y = 0; y < 4; ++y)
+            {
+                const int sourceY = std::min(blockY * 4 + y, height - 1);
+                for (int x = 0; x < 4; ++x)
+                {
+                    const int sourceX = std::min(blockX * 4 + x, width - 1);
+                    std::memcpy(block + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                }
+            }
+            uint8_t* destination = output.data() + (static_cast<size_t>(blockY) * blocksX + blockX) * blockSize;
+            switch (format)
+            {
+                case EBlockFormat::BC1: Encode_Block_BC1(block, destination); break;
+                case EBlockFormat::BC3: Encode_Block_BC3(block, destination); break;
+                case EBlockFormat::BC7: Encode_Block_BC7(block, destination); break;
+            }
+        }
+    }
+    return output;
+}
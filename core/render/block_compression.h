@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * CPU encoders for the GPU block compressed formats, used by cherry_cook.
+ * Every format stores 4x4 pixel blocks, images whose size is not a multiple of 4 repeat their
+ * edge pixels into the partial blocks.
+ *
+ *   BC1  8 bytes per block, RGB 565 endpoints with 2 bit indices, no alpha(6:1 against RGB8)
+ *   BC3  16 bytes per block, BC1 color plus an 8 level alpha block(4:1 against RGBA8)
+ *   BC7  16 bytes per block, only mode 6 is written: one RGBA 7777+p-bit endpoint pair with 4 bit
+ *        indices, far better gradients and alpha than BC3 at the same size
+ *
+ * Endpoints come from the principal axis of the block colors, the indices are then chosen
+ * against the quantized endpoints so the rounding of the endpoints is accounted for.
+ * Does not depend on OpenGL.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class EBlockFormat : unsigned char
+{
+    BC1,
+    BC3,
+    BC7
+};
+
+/* Bytes of one 4x4 block */
+constexpr size_t Block_Size(EBlockFormat format)
+{
+    return format == EBlockFormat::BC1 ? 8 : 16;
+}
+
+/* Bytes of a width x height image, partial blocks count as whole */
+constexpr size_t Compressed_Size(EBlockFormat format, int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * Block_Size(format);
+}
+
+/**
+ * @brief Compresses an RGBA8 image
+ *
+ * @param  rgba: tightly packed RGBA8 pixels, the row order is kept as is
+ * @param  width, height: size of the image
+ * @param  format: block format to encode to
+ *
+ * @return std::vector<uint8_t>: blocks row by row, Compressed_Size(format, width, height) bytes
+ */
+std::vector<uint8_t> Compress_Blocks(const uint8_t* rgba, int width, int height, EBlockFormat format);
+
+/* Single block encoders, block is 16 RGBA8 pixels row by row */
+void Encode_Block_BC1(const uint8_t block[64], uint8_t output[8]);
+void Encode_Block_BC3(const uint8_t block[64], uint8_t output[16]);
+void Encode_Block_BC7(const uint8_t block[64], uint8_t output[16]);
@@ -0,0 +1,181 @@
+#include "cooked_texture.h"
+
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHERRY_HAS_MMAP
+#endif
+
+static constexpr uint64_t s_levelAlignment = 16;
+
+CookedTexture::~CookedTexture()
+{
+    close();
+}
+
+bool CookedTexture::open(const std::string& path)
+{
+    close();
+#ifdef CHERRY_HAS_MMAP
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file == -1)
+    {
+        return false;
+    }
+    struct stat info{};
+    if (fstat(file, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CookedTextureHeader)))
+    {
+        ::close(file);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // the mapping stays valid
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    m_data = static_cast<const uint8_t*>(mapped);
+    m_size = static_cast<size_t>(info.st_size);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        return false;
+    }
+    m_buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+    if (!file || m_buffer.size() < sizeof(CookedTextureHeader))
+    {
+        m_buffer.clear();
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    if (!validate())
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Invalid cooked texture ", path);
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CookedTexture::openMemory(const uint8_t* data, size_t size)
+{
+    close();
+    if (size < sizeof(CookedTextureHeader))
+    {
+        return false;
+    }
+    m_data = data;
+    m_size = size;
+    m_bMapped = false;
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Bytes OpenGL reads for a level of this size, 4x4 blocks of 8(BC1) or 16 bytes for the compressed formats
+static uint64_t Level_Size(ECookedFormat format, uint64_t width, uint64_t height)
+{
+    switch (format)
+    {
+        case ECookedFormat::RGB8:
+            return width * height * 3;
+        case ECookedFormat::RGBA8:
+            return width * height * 4;
+        case ECookedFormat::BC1:
+            return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+        case ECookedFormat::BC3:
+        case ECookedFormat::BC7:
+            return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+    }
+    return 0;
+}
+
+bool CookedTexture::validate() const
+{
+    // Validate everything the loader will index so a broken file can not read out of bounds,
+    // OpenGL reads as many bytes as the format and size of a level say whatever the entry claims
+    const CookedTextureHeader& fileHeader = header();
+    bool bValid = fileHeader.magic == s_magic && fileHeader.version == s_version && fileHeader.format <= static_cast<uint32_t>(ECookedFormat::BC7) &&
+                  fileHeader.width > 0 && fileHeader.height > 0 && fileHeader.mipCount > 0 && fileHeader.mipCount <= 32 &&
+                  sizeof(CookedTextureHeader) + static_cast<uint64_t>(fileHeader.mipCount) * sizeof(CookedMipEntry) <= m_size;
+    for (uint32_t level = 0; bValid && level < fileHeader.mipCount; ++level)
+    {
+        const CookedMipEntry* entry = reinterpret_cast<const CookedMipEntry*>(m_data + sizeof(CookedTextureHeader)) + level;
+        // every level halves the one before it, down to 1
+        const uint32_t width = std::max(fileHeader.width >> level, 1u);
+        const uint32_t height = std::max(fileHeader.height >> level, 1u);
+        bValid = entry->width == width && entry->height == height && entry->size == Level_Size(getFormat(), width, height) &&
+                 entry->offset <= m_size && entry->size <= m_size - entry->offset;
+    }
+    return bValid;
+}
+
+void CookedTexture::close()
+{
+#ifdef CHERRY_HAS_MMAP
+    if (m_data && m_bMapped)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_bMapped = true;
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+CookedMip CookedTexture::getMip(uint32_t level) const
+{
+    const CookedMipEntry& entry = reinterpret_cast<const CookedMipEntry*>(m_data + sizeof(CookedTextureHeader))[level];
+    return CookedMip{static_cast<int>(entry.width), static_cast<int>(entry.height), m_data + entry.offset, static_cast<size_t>(entry.size)};
+}
+
+bool CookedTexture::write(const std::string& path, ECookedFormat format, const std::vector<MipLevel>& levels)
+{
+    if (levels.empty())
+    {
+        return false;
+    }
+    CookedTextureHeader fileHeader{s_magic, s_version, static_cast<uint32_t>(format),
+                                   static_cast<uint32_t>(levels[0].width), static_cast<uint32_t>(levels[0].height),
+                                   static_cast<uint32_t>(levels.size())};
+    std::vector<CookedMipEntry> entries(levels.size());
+    uint64_t offset = sizeof(CookedTextureHeader) + entries.size() * sizeof(CookedMipEntry);
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        offset = (offset + s_levelAlignment - 1) & ~(s_levelAlignment - 1);
+        entries[level] = {static_cast<uint32_t>(levels[level].width), static_cast<uint32_t>(levels[level].height), offset, levels[level].pixels.size()};
+        offset += levels[level].pixels.size();
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(CookedMipEntry));
+    for (size_t level = 0; level < levels.size(); ++level)
+    {
+        const char zeros[s_levelAlignment] = {};
+        file.write(zeros, entries[level].offset - static_cast<uint64_t>(file.tellp()));
+        file.write(reinterpret_cast<const char*>(levels[level].pixels.data()), levels[level].pixels.size());
+    }
+    return static_cast<bool>(file);
+}
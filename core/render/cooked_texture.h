@@ -0,0 +1,103 @@
+#pragma once
+
+/*
+ * GPU ready texture written by the cherry_cook tool(tools/cherry_cook).
+ * The pixels are already flipped vertically, already in the format they are uploaded in and every
+ * mip level is stored, so loading one is mapping the file and handing the levels to OpenGL.
+ * No decoding, flipping or glGenerateMipmap at runtime.
+ *
+ * Layout, little endian:
+ *   CookedTextureHeader
+ *   CookedMipEntry[mipCount]      level 0 first
+ *   level data, each level starts on a 16 byte boundary
+ *
+ * Does not depend on OpenGL so the cooker can use it without a context.
+ */
+
+#include "mip_generator.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/* Pixel format of the stored levels, the loader maps it to the GL formats */
+enum class ECookedFormat : uint32_t
+{
+    RGB8 = 0,
+    RGBA8 = 1,
+    BC1 = 2, /* block compressed, see block_compression.h */
+    BC3 = 3,
+    BC7 = 4
+};
+
+struct CookedTextureHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format; // ECookedFormat
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipCount;
+};
+
+struct CookedMipEntry
+{
+    uint32_t width;
+    uint32_t height;
+    uint64_t offset; // from the start of the file
+    uint64_t size;
+};
+
+/* One stored level, data points into the mapped file */
+struct CookedMip
+{
+    int width;
+    int height;
+    const uint8_t* data;
+    size_t size;
+};
+
+class CookedTexture
+{
+public:
+    static constexpr uint32_t s_magic = 0x58455443; // "CTEX"
+    static constexpr uint32_t s_version = 1;
+
+    CookedTexture() = default;
+    ~CookedTexture();
+
+    CookedTexture(const CookedTexture&) = delete;
+    CookedTexture& operator=(const CookedTexture&) = delete;
+
+    // Maps the file read only, false if it is missing, truncated or from another version
+    bool open(const std::string& path);
+    // Reads a cooked texture that is already in memory(an AssetPack blob for example) without copying it,
+    // the memory must outlive the CookedTexture. The levels need the same 16 byte alignment as in a file.
+    bool openMemory(const uint8_t* data, size_t size);
+    void close();
+
+    ECookedFormat getFormat() const { return static_cast<ECookedFormat>(header().format); }
+    int getWidth() const { return static_cast<int>(header().width); }
+    int getHeight() const { return static_cast<int>(header().height); }
+    uint32_t getMipCount() const { return header().mipCount; }
+    CookedMip getMip(uint32_t level) const;
+
+    // levels[0] is the full size image, the others its mips in order
+    static bool write(const std::string& path, ECookedFormat format, const std::vector<MipLevel>& levels);
+
+    static int channelsOf(ECookedFormat format) { return (format == ECookedFormat::RGB8 || format == ECookedFormat::BC1) ? 3 : 4; }
+    static bool isCompressed(ECookedFormat format) { return format >= ECookedFormat::BC1; }
+
+private:
+    const CookedTextureHeader& header() const { return *reinterpret_cast<const CookedTextureHeader*>(m_data); }
+    // Whether the header and the level table describe levels inside the data, each of the size its format and dimensions need
+    bool validate() const;
+
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    // false when the data belongs to someone else(openMemory)
+    bool m_bMapped = true;
+    // platforms without mmap read the file into memory instead
+    std::vector<uint8_t> m_buffer;
+};
@@ -0,0 +1,135 @@
+#include "dynamic_texture.h"
+
+#include <algorithm>
+#include <cstring>
+
+DynamicTexture::DynamicTexture(const std::string& name, int width, int height, uint32_t clearColor)
+    : Texture(name, width, height, clearColor)
+{
+}
+
+bool DynamicTexture::clip(int& x, int& y, int& rectWidth, int& rectHeight) const
+{
+    const int x0 = std::max(x, 0);
+    const int y0 = std::max(y, 0);
+    const int x1 = std::min(x + rectWidth, width);
+    const int y1 = std::min(y + rectHeight, height);
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return false;
+    }
+    x = x0;
+    y = y0;
+    rectWidth = x1 - x0;
+    rectHeight = y1 - y0;
+    return true;
+}
+
+void DynamicTexture::setPixel(int x, int y, uint32_t color)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+    {
+        return;
+    }
+    pixels[static_cast<size_t>(y) * width + x] = color;
+    addDirty({x, y, x + 1, y + 1});
+}
+
+void DynamicTexture::fillRect(int x, int y, int rectWidth, int rectHeight, uint32_t color)
+{
+    if (!clip(x, y, rectWidth, rectHeight))
+    {
+        return;
+    }
+    for (int row = y; row < y + rectHeight; ++row)
+    {
+        uint32_t* destination = pixels.data() + static_cast<size_t>(row) * width + x;
+        std::fill(destination, destination + rectWidth, color);
+    }
+    addDirty({x, y, x + rectWidth, y + rectHeight});
+}
+
+void DynamicTexture::writeRect(int x, int y, int rectWidth, int rectHeight, const uint32_t* source)
+{
+    const int sourceStride = rectWidth;
+    const int sourceX = x;
+    const int sourceY = y;
+    if (!clip(x, y, rectWidth, rectHeight))
+    {
+        return;
+    }
+    // The part of the source that survived the clip
+    source += static_cast<size_t>(y - sourceY) * sourceStride + (x - sourceX);
+    for (int row = 0; row < rectHeight; ++row)
+    {
+        std::memcpy(pixels.data() + static_cast<size_t>(y + row) * width + x, source + static_cast<size_t>(row) * sourceStride,
+                    static_cast<size_t>(rectWidth) * sizeof(uint32_t));
+    }
+    addDirty({x, y, x + rectWidth, y + rectHeight});
+}
+
+void DynamicTexture::markDirty(int x, int y, int rectWidth, int rectHeight)
+{
+    if (clip(x, y, rectWidth, rectHeight))
+    {
+        addDirty({x, y, x + rectWidth, y + rectHeight});
+    }
+}
+
+void DynamicTexture::addDirty(DirtyRect rect)
+{
+    // Merging when the bounding box is no more to upload than the two rectangles: one inside the other,
+    // overlapping ones or strips of the same width(height). Repeated because the merged one may now fit another.
+    for (size_t i = 0; i < m_dirtyRects.size();)
+    {
+        const DirtyRect& other = m_dirtyRects[i];
+        const DirtyRect merged{std::min(rect.x0, other.x0), std::min(rect.y0, other.y0), std::max(rect.x1, other.x1), std::max(rect.y1, other.y1)};
+        if (merged.area() <= rect.area() + other.area())
+        {
+            rect = merged;
+            m_dirtyRects[i] = m_dirtyRects.back();
+            m_dirtyRects.pop_back();
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+    m_dirtyRects.push_back(rect);
+
+    if (m_dirtyRects.size() > s_maxDirtyRects)
+    {
+        // Too many small uploads cost more than sending the clean pixels between them
+        DirtyRect bounds = m_dirtyRects[0];
+        for (const DirtyRect& dirty : m_dirtyRects)
+        {
+            bounds = {std::min(bounds.x0, dirty.x0), std::min(bounds.y0, dirty.y0), std::max(bounds.x1, dirty.x1), std::max(bounds.y1, dirty.y1)};
+        }
+        m_dirtyRects.assign(1, bounds);
+    }
+}
+
+void DynamicTexture::uploadDirty()
+{
+    m_uploadedBytes = 0;
+    if (m_dirtyRects.empty())
+    {
+        return;
+    }
+    if (s_bCpuOnly)
+    {
+        m_dirtyRects.clear();
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, ID);
+    // The rectangles are read straight out of the whole image
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    for (const DirtyRect& rect : m_dirtyRects)
+    {
+        const uint32_t* first = pixels.data() + static_cast<size_t>(rect.y0) * width + rect.x0;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0, GL_RGBA, GL_UNSIGNED_BYTE, first);
+        m_uploadedBytes += static_cast<size_t>(rect.area()) * sizeof(uint32_t);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    m_dirtyRects.clear();
+}
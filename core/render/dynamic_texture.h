@@ -0,0 +1,69 @@
+#pragma once
+
+/*
+ * Texture whose pixels are changed while the game runs: minimaps, fog of war, procedural effects.
+ * The pixels live in RAM(Texture::pixels, RGBA8, bottom row first), every write marks the rectangle it
+ * touched as dirty and uploadDirty() sends only the dirty rectangles to the GPU with glTexSubImage2D.
+ *
+ * Overlapping or touching rectangles are merged, past s_maxDirtyRects they collapse into their bounding box
+ * so the number of uploads per frame stays small.
+ * With Texture::s_bCpuOnly the rasterizer reads the pixels directly and uploadDirty() only clears the rectangles.
+ *
+ * Example usage:
+ * @code
+ * std::shared_ptr<DynamicTexture> fog = resourceManager.CreateDynamicTexture("fog", 256, 256, 0xFF000000);
+ * fog->fillRect(playerX - 8, playerY - 8, 16, 16, 0x00000000);
+ * // ResourceManager::Update() uploads the 16x16 area before the next frame
+ * @endcode
+ */
+
+#include "basic_texture.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class DynamicTexture : public Texture
+{
+public:
+    static constexpr size_t s_maxDirtyRects = 8;
+
+    // Allocates a width x height RGBA8 texture filled with clearColor(0xAABBGGRR)
+    DynamicTexture(const std::string& name, int width, int height, uint32_t clearColor = 0);
+
+    // Pixels are clipped to the texture, writes outside of it are ignored
+    void setPixel(int x, int y, uint32_t color);
+    void fillRect(int x, int y, int rectWidth, int rectHeight, uint32_t color);
+    // Copies rectWidth x rectHeight tightly packed pixels
+    void writeRect(int x, int y, int rectWidth, int rectHeight, const uint32_t* source);
+
+    // For writes done through the pixels member directly
+    void markDirty(int x, int y, int rectWidth, int rectHeight);
+    bool isDirty() const { return !m_dirtyRects.empty(); }
+
+    // GL thread only. Uploads the dirty rectangles, done once per frame by ResourceManager::Update()
+    void uploadDirty();
+
+    // Bytes sent by the last uploadDirty()
+    size_t getUploadedBytes() const { return m_uploadedBytes; }
+
+private:
+    // Half open, [x0, x1) x [y0, y1)
+    struct DirtyRect
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+
+        int64_t area() const { return static_cast<int64_t>(x1 - x0) * (y1 - y0); }
+    };
+
+    // Clips the rectangle to the texture, false if nothing is left
+    bool clip(int& x, int& y, int& rectWidth, int& rectHeight) const;
+    // Adds a clipped rectangle, merging it with the ones it overlaps or touches
+    void addDirty(DirtyRect rect);
+
+    std::vector<DirtyRect> m_dirtyRects;
+    size_t m_uploadedBytes = 0;
+};
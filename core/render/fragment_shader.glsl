@@ -1,9 +1,37 @@
 #version 330 core
 in vec2 TexCoord;
+in vec4 Color;
+#ifdef CHERRY_LIT
+in vec2 WorldPos;
+#endif
 out vec4 FragColor;
 
+// The CHERRY_* defines are injected per variant by ShaderVariantCache
+#ifdef CHERRY_TEXTURED
 uniform sampler2D uTexture;
+#endif
+#ifdef CHERRY_LIT
+uniform vec3 uAmbientLight;
+uniform vec2 uLightPosition;
+uniform vec3 uLightColor;
+uniform float uLightRadius;
+#endif
 
 void main() {
-    FragColor = texture(uTexture, TexCoord);
+    vec4 color = vec4(1.0);
+#ifdef CHERRY_TEXTURED
+    color *= texture(uTexture, TexCoord);
+#endif
+#ifdef CHERRY_TINTED
+    color *= Color;
+#endif
+#ifdef CHERRY_ALPHA_TEST
+    if (color.a < 0.5)
+        discard;
+#endif
+#ifdef CHERRY_LIT
+    float attenuation = clamp(1.0 - distance(WorldPos, uLightPosition) / uLightRadius, 0.0, 1.0);
+    color.rgb *= uAmbientLight + uLightColor * attenuation * attenuation;
+#endif
+    FragColor = color;
 }
@@ -0,0 +1,278 @@
+#include "mip_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Source rows(or columns) averaged into destination row y, 3 for the last one of an odd size
+    inline int Footprint(int index, int mipSize, int size)
+    {
+        if (size == 1)
+        {
+            return 1;
+        }
+        return (index == mipSize - 1 && (size & 1)) ? 3 : 2;
+    }
+
+    // Decoding is a lookup, encoding looks up the linear value quantized to 12 bits
+    struct SrgbTables
+    {
+        float toLinear[256];
+        uint8_t fromLinear[4096];
+
+        SrgbTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                const float c = i / 255.0f;
+                toLinear[i] = (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            for (int i = 0; i < 4096; ++i)
+            {
+                const float l = i / 4095.0f;
+                const float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                fromLinear[i] = static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    };
+
+    const SrgbTables& Srgb()
+    {
+        static const SrgbTables s_tables;
+        return s_tables;
+    }
+
+    // Same footprint as Downsample_Box on linear values
+    void Downsample_Linear(const float* source, int width, int height, int channels, float* destination)
+    {
+        const int mipWidth = std::max(width / 2, 1);
+        const int mipHeight = std::max(height / 2, 1);
+        const size_t stride = static_cast<size_t>(width) * channels;
+        for (int y = 0; y < mipHeight; ++y)
+        {
+            const int y0 = std::min(y * 2, height - 1);
+            const int rows = Footprint(y, mipHeight, height);
+            for (int x = 0; x < mipWidth; ++x)
+            {
+                const int x0 = std::min(x * 2, width - 1);
+                const int columns = Footprint(x, mipWidth, width);
+                const float weight = 1.0f / static_cast<float>(rows * columns);
+                float* texel = destination + (static_cast<size_t>(y) * mipWidth + x) * channels;
+#if defined(__SSE2__)
+                if (channels == 4)
+                {
+                    // a whole RGBA texel per register
+                    __m128 sum = _mm_setzero_ps();
+                    for (int row = 0; row < rows; ++row)
+                    {
+                        const float* line = source + static_cast<size_t>(y0 + row) * stride + static_cast<size_t>(x0) * 4;
+                        for (int column = 0; column < columns; ++column)
+                        {
+                            sum = _mm_add_ps(sum, _mm_loadu_ps(line + column * 4));
+                        }
+                    }
+                    _mm_storeu_ps(texel, _mm_mul_ps(sum, _mm_set1_ps(weight)));
+                    continue;
+                }
+#endif
+                for (int c = 0; c < channels; ++c)
+                {
+                    float sum = 0.0f;
+                    for (int row = 0; row < rows; ++row)
+                    {
+                        const float* line = source + static_cast<size_t>(y0 + row) * stride;
+                        for (int column = 0; column < columns; ++column)
+                        {
+                            sum += line[static_cast<size_t>(x0 + column) * channels + c];
+                        }
+                    }
+                    texel[c] = sum * weight;
+                }
+            }
+        }
+    }
+}
+
+void Downsample_Box(const uint8_t* source, int width, int height, int channels, uint8_t* destination)
+{
+    const int mipWidth = std::max(width / 2, 1);
+    const int mipHeight = std::max(height / 2, 1);
+    const size_t stride = static_cast<size_t>(width) * channels;
+    for (int y = 0; y < mipHeight; ++y)
+    {
+        // with an odd height the last destination row also averages the leftover source row
+        const int y0 = std::min(y * 2, height - 1);
+        const int rows = Footprint(y, mipHeight, height);
+        int x = 0;
+#if defined(__SSE2__)
+        if (channels == 4 && rows == 2 && width > 1)
+        {
+            // 4 source texels of two rows become 2 destination texels, 16 bit sums do not overflow
+            const uint8_t* top = source + static_cast<size_t>(y0) * stride;
+            const uint8_t* bottom = top + stride;
+            const int evenColumns = mipWidth - (width & 1); // the folded last column is left to the scalar loop
+            const __m128i zero = _mm_setzero_si128();
+            const __m128i rounding = _mm_set1_epi16(2);
+            for (; x + 2 <= evenColumns; x += 2)
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 8));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 8));
+                const __m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                const __m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                // add the right texel of each pair to the left one
+                const __m128i pairLow = _mm_add_epi16(low, _mm_srli_si128(low, 8));
+                const __m128i pairHigh = _mm_add_epi16(high, _mm_srli_si128(high, 8));
+                __m128i sums = _mm_unpacklo_epi64(pairLow, pairHigh);
+                sums = _mm_srli_epi16(_mm_add_epi16(sums, rounding), 2);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + (static_cast<size_t>(y) * mipWidth + x) * 4), _mm_packus_epi16(sums, zero));
+            }
+        }
+#endif
+        for (; x < mipWidth; ++x)
+        {
+            const int x0 = std::min(x * 2, width - 1);
+            const int columns = Footprint(x, mipWidth, width);
+            for (int c = 0; c < channels; ++c)
+            {
+                uint32_t sum = 0;
+                for (int row = 0; row < rows; ++row)
+                {
+                    const uint8_t* line = source + static_cast<size_t>(y0 + row) * stride;
+                    for (int column = 0; column < columns; ++column)
+                    {
+                        sum += line[static_cast<size_t>(x0 + column) * channels + c];
+                    }
+                }
+                const uint32_t count = static_cast<uint32_t>(rows * columns);
+                destination[(static_cast<size_t>(y) * mipWidth + x) * channels + c] = static_cast<uint8_t>((sum + count / 2) / count);
+            }
+        }
+    }
+}
+
+std::vector<MipLevel> Generate_Mip_Chain(const uint8_t* pixels, int width, int height, int channels, const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    const int alpha = (channels == 2 || channels == 4) ? channels - 1 : -1;
+    const bool bPremultiply = options.bPremultipliedAlpha && alpha != -1;
+
+    if (!options.bSrgb && !bPremultiply)
+    {
+        // Plain averages of the bytes, every level is filtered from the previous one
+        const uint8_t* source = pixels;
+        while (width > 1 || height > 1)
+        {
+            MipLevel level;
+            level.width = std::max(width / 2, 1);
+            level.height = std::max(height / 2, 1);
+            level.pixels.resize(static_cast<size_t>(level.width) * level.height * channels);
+            Downsample_Box(source, width, height, channels, level.pixels.data());
+            width = level.width;
+            height = level.height;
+            levels.push_back(std::move(level));
+            source = levels.back().pixels.data();
+        }
+        return levels;
+    }
+
+    // The chain is filtered in linear float, only the stored levels are quantized(never the ones they are filtered from)
+    const SrgbTables& srgb = Srgb();
+    std::vector<float> linear(static_cast<size_t>(width) * height * channels);
+    for (size_t texel = 0; texel < linear.size(); texel += channels)
+    {
+#if defined(__SSE2__)
+        if (channels == 4)
+        {
+            // a whole RGBA texel per register, SSE2 has no gather so the sRGB lookups stay scalar
+            const uint8_t* source = pixels + texel;
+            const float a = source[3] / 255.0f;
+            __m128 color;
+            if (options.bSrgb)
+            {
+                color = _mm_setr_ps(srgb.toLinear[source[0]], srgb.toLinear[source[1]], srgb.toLinear[source[2]], a);
+            }
+            else
+            {
+                int32_t bytes = 0;
+                std::memcpy(&bytes, source, sizeof(bytes));
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+                color = _mm_div_ps(_mm_cvtepi32_ps(widened), _mm_set1_ps(255.0f));
+            }
+            const __m128 coverage = bPremultiply ? _mm_setr_ps(a, a, a, 1.0f) : _mm_set1_ps(1.0f);
+            _mm_storeu_ps(linear.data() + texel, _mm_mul_ps(color, coverage));
+            continue;
+        }
+#endif
+        const float coverage = bPremultiply ? pixels[texel + alpha] / 255.0f : 1.0f;
+        for (int c = 0; c < channels; ++c)
+        {
+            const uint8_t value = pixels[texel + c];
+            if (c == alpha)
+            {
+                linear[texel + c] = value / 255.0f;
+                continue;
+            }
+            linear[texel + c] = (options.bSrgb ? srgb.toLinear[value] : value / 255.0f) * coverage;
+        }
+    }
+
+    std::vector<float> filtered;
+    while (width > 1 || height > 1)
+    {
+        MipLevel level;
+        level.width = std::max(width / 2, 1);
+        level.height = std::max(height / 2, 1);
+        filtered.resize(static_cast<size_t>(level.width) * level.height * channels);
+        Downsample_Linear(linear.data(), width, height, channels, filtered.data());
+
+        level.pixels.resize(filtered.size());
+        for (size_t texel = 0; texel < filtered.size(); texel += channels)
+        {
+            // fully transparent texels keep no color
+            const float coverage = bPremultiply ? filtered[texel + alpha] : 1.0f;
+            const float unpremultiply = coverage > 0.0f ? 1.0f / coverage : 0.0f;
+#if defined(__SSE2__)
+            if (channels == 4)
+            {
+                // unpremultiplied, clamped and quantized together, to 12 bits for the sRGB lookup and 8 bits otherwise
+                const __m128 scale = _mm_setr_ps(options.bSrgb ? 4095.0f : 255.0f, options.bSrgb ? 4095.0f : 255.0f, options.bSrgb ? 4095.0f : 255.0f, 255.0f);
+                __m128 value = _mm_mul_ps(_mm_loadu_ps(filtered.data() + texel), _mm_setr_ps(unpremultiply, unpremultiply, unpremultiply, 1.0f));
+                value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+                const __m128i quantized = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, scale), _mm_set1_ps(0.5f)));
+                uint8_t* destination = level.pixels.data() + texel;
+                if (options.bSrgb)
+                {
+                    alignas(16) int32_t indices[4];
+                    _mm_store_si128(reinterpret_cast<__m128i*>(indices), quantized);
+                    destination[0] = srgb.fromLinear[indices[0]];
+                    destination[1] = srgb.fromLinear[indices[1]];
+                    destination[2] = srgb.fromLinear[indices[2]];
+                    destination[3] = static_cast<uint8_t>(indices[3]);
+                    continue;
+                }
+                const int32_t bytes = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(quantized, quantized), quantized));
+                std::memcpy(destination, &bytes, sizeof(bytes));
+                continue;
+            }
+#endif
+            for (int c = 0; c < channels; ++c)
+            {
+                const float value = std::clamp((c == alpha) ? filtered[texel + c] : filtered[texel + c] * unpremultiply, 0.0f, 1.0f);
+                level.pixels[texel + c] = (options.bSrgb && c != alpha) ? srgb.fromLinear[static_cast<int>(value * 4095.0f + 0.5f)]
+                                                                        : static_cast<uint8_t>(value * 255.0f + 0.5f);
+            }
+        }
+        width = level.width;
+        height = level.height;
+        levels.push_back(std::move(level));
+        linear.swap(filtered);
+    }
+    return levels;
+}
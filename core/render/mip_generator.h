@@ -0,0 +1,45 @@
+#pragma once
+
+/*
+ * CPU mipmap generation, shared by the cherry_cook tool and the texture loader.
+ * Each level is a 2x2 box filter of the previous one, odd sizes round down(never below 1)
+ * and the last row/column of an odd level is folded into its neighbours like glGenerateMipmap does.
+ *
+ * Generating the chain on a worker replaces glGenerateMipmap, whose quality and speed depend on the
+ * driver and which runs on the GL thread. The inner loops use SSE2 for 4 channel images when available.
+ *
+ * By default colors are averaged as light(sRGB decoded to linear and encoded back) and weighted by
+ * their alpha, so mips do not darken and transparent texels do not bleed their color into the edges.
+ * Turn both off for images that are data rather than color(normal maps, masks).
+ */
+
+#include <cstdint>
+#include <vector>
+
+struct MipLevel
+{
+    int width{0};
+    int height{0};
+    std::vector<uint8_t> pixels; // tightly packed rows, bottom row first like the source
+};
+
+struct MipOptions
+{
+    bool bSrgb{true};                // color channels are sRGB encoded, the alpha channel is always linear
+    bool bPremultipliedAlpha{true};  // filter premultiplied by alpha, the levels are stored straight again
+};
+
+/**
+ * @brief Builds every level below the source down to 1x1
+ *
+ * @param  pixels: source level, tightly packed
+ * @param  width, height: size of the source level
+ * @param  channels: bytes per pixel, 1 to 4. With 2 and 4 channels the last one is alpha.
+ * @param  options: how color and alpha are filtered
+ *
+ * @return std::vector<MipLevel>: level 1 first, the source itself is not included
+ */
+std::vector<MipLevel> Generate_Mip_Chain(const uint8_t* pixels, int width, int height, int channels, const MipOptions& options = {});
+
+/* One 2x2 box filter step without any color conversion, destination must hold max(width/2,1) x max(height/2,1) pixels */
+void Downsample_Box(const uint8_t* source, int width, int height, int channels, uint8_t* destination);
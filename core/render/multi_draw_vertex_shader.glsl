@@ -0,0 +1,25 @@
+#version 420 core
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+// one instance per draw, baseInstance selects the texture slot
+layout (location = 3) in uint aTextureSlot;
+
+uniform mat4 uProjection;
+
+out vec2 TexCoord;
+out vec4 Color;
+flat out uint TextureSlot;
+#ifdef CHERRY_LIT
+out vec2 WorldPos;
+#endif
+
+void main() {
+    gl_Position = uProjection * vec4(aPos, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Color = aColor;
+    TextureSlot = aTextureSlot;
+#ifdef CHERRY_LIT
+    WorldPos = aPos;
+#endif
+}
@@ -0,0 +1,89 @@
+#include "pixel_upload_ring.h"
+
+PixelUploadRing::PixelUploadRing(uint32_t slotsCount)
+    : m_slots(slotsCount)
+{
+    for (Slot& slot : m_slots)
+    {
+        glGenBuffers(1, &slot.buffer);
+    }
+}
+
+PixelUploadRing::~PixelUploadRing()
+{
+    for (Slot& slot : m_slots)
+    {
+        if (slot.state == ESlotState::Mapped)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        if (slot.fence)
+        {
+            glDeleteSync(slot.fence);
+        }
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+int PixelUploadRing::map(size_t size)
+{
+    const uint32_t slotsCount = static_cast<uint32_t>(m_slots.size());
+    for (uint32_t i = 0; i < slotsCount; ++i)
+    {
+        const uint32_t index = (m_next + i) % slotsCount;
+        Slot& slot = m_slots[index];
+        if (slot.state == ESlotState::InFlight)
+        {
+            // timeout 0 only asks, it never waits for the GPU
+            GLenum status = glClientWaitSync(slot.fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                continue;
+            }
+            glDeleteSync(slot.fence);
+            slot.fence = nullptr;
+            slot.state = ESlotState::Free;
+        }
+        if (slot.state != ESlotState::Free)
+        {
+            continue;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+        if (slot.capacity < size)
+        {
+            // grows to the largest image seen, big textures are rare and the memory is reused
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            slot.capacity = size;
+        }
+        // the previous transfer is done, invalidating lets the driver skip any synchronization
+        slot.mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!slot.mapped)
+        {
+            return -1;
+        }
+        slot.state = ESlotState::Mapped;
+        m_next = (index + 1) % slotsCount;
+        return static_cast<int>(index);
+    }
+    return -1;
+}
+
+void PixelUploadRing::bindForUpload(int slot)
+{
+    Slot& target = m_slots[slot];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, target.buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    target.mapped = nullptr;
+}
+
+void PixelUploadRing::finishUpload(int slot)
+{
+    Slot& target = m_slots[slot];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    target.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    target.state = ESlotState::InFlight;
+}
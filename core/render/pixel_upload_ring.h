@@ -0,0 +1,64 @@
+#pragma once
+
+/*
+ * Ring of pixel buffer objects(GL_PIXEL_UNPACK_BUFFER) for texture uploads.
+ * Pixels are copied into a mapped slot(by any thread, only mapping and uploading need the GL thread),
+ * then glTexSubImage2D sources them from the buffer into storage the texture allocated before the slot was
+ * bound(Texture::allocateLevels). The call returns right away and the driver transfers the pixels with DMA,
+ * instead of copying them out of client memory before returning.
+ * A fence per slot tells when the transfer is done and the slot can be mapped again.
+ *
+ * Example usage:
+ * @code
+ * PixelUploadRing ring;
+ * int slot = ring.map(size);        // GL thread, -1 while every slot is in flight
+ * memcpy(ring.getMapped(slot), pixels, size); // any thread
+ * texture.upload(ring, slot, image); // GL thread
+ * @endcode
+ */
+
+#include <glad/gl.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class PixelUploadRing
+{
+public:
+    explicit PixelUploadRing(uint32_t slotsCount = 4);
+    ~PixelUploadRing();
+
+    PixelUploadRing(const PixelUploadRing&) = delete;
+    PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+    // GL thread. Maps a free slot of at least size bytes, returns -1 when every slot is still in flight
+    int map(size_t size);
+    // Mapped memory of the slot, write only, valid until bindForUpload()
+    void* getMapped(int slot) const { return m_slots[slot].mapped; }
+
+    // GL thread. Unmaps the slot and binds it as GL_PIXEL_UNPACK_BUFFER, pixel pointers become offsets into it
+    void bindForUpload(int slot);
+    // GL thread. Unbinds the slot and fences the transfer, the slot is reused once the fence signals
+    void finishUpload(int slot);
+
+private:
+    enum class ESlotState : unsigned char
+    {
+        Free,
+        Mapped,
+        InFlight /* waiting for the fence */
+    };
+
+    struct Slot
+    {
+        unsigned int buffer{0};
+        size_t capacity{0};
+        void* mapped{nullptr};
+        GLsync fence{nullptr};
+        ESlotState state{ESlotState::Free};
+    };
+
+    std::vector<Slot> m_slots;
+    // slots are handed out in order so the oldest transfer is the first one checked
+    uint32_t m_next = 0;
+};
@@ -0,0 +1,881 @@
+#include "png_decoder.h"
+
+#include <thread_pool.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Compressed streams smaller than this are not worth splitting across threads
+    constexpr size_t s_parallelMinBytes = 1024 * 1024;
+    // Flush points closer than this to the previous split are skipped
+    constexpr size_t s_parallelMinSegment = 128 * 1024;
+
+    constexpr int s_fastBits = 10;
+    constexpr uint32_t s_fastSize = 1u << s_fastBits;
+
+    constexpr uint16_t s_lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+    constexpr uint8_t s_lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    constexpr uint16_t s_distanceBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                             1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    constexpr uint8_t s_distanceExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    constexpr uint8_t s_codeLengthOrder[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    inline uint32_t Reverse_Bits(uint32_t code, int length)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < length; ++i)
+        {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    /*
+     * Canonical Huffman code. Codes up to s_fastBits long are decoded with one lookup of the next bits,
+     * longer ones by comparing the bit reversed code against the last code of every length.
+     */
+    struct HuffmanTable
+    {
+        uint16_t fast[s_fastSize];       // (length << 9) | symbol, 0 for codes longer than s_fastBits
+        uint32_t maxCode[17];            // one past the last code of each length, left aligned to 16 bits
+        uint16_t firstCode[16];
+        uint16_t firstSymbol[16];
+        uint8_t lengths[288];            // by sorted position
+        uint16_t symbols[288];
+
+        bool build(const uint8_t* codeLengths, int count)
+        {
+            int sizes[17] = {};
+            std::memset(fast, 0, sizeof(fast));
+            std::memset(lengths, 0, sizeof(lengths));
+            for (int i = 0; i < count; ++i)
+            {
+                ++sizes[codeLengths[i]];
+            }
+            sizes[0] = 0;
+            uint32_t nextCode[16];
+            uint32_t code = 0;
+            int k = 0;
+            for (int length = 1; length < 16; ++length)
+            {
+                nextCode[length] = code;
+                firstCode[length] = static_cast<uint16_t>(code);
+                firstSymbol[length] = static_cast<uint16_t>(k);
+                code += sizes[length];
+                if (sizes[length] && code - 1 >= (1u << length))
+                {
+                    return false; // over-subscribed
+                }
+                maxCode[length] = code << (16 - length);
+                code <<= 1;
+                k += sizes[length];
+            }
+            maxCode[16] = 0x10000;
+            for (int symbol = 0; symbol < count; ++symbol)
+            {
+                const int length = codeLengths[symbol];
+                if (length == 0)
+                {
+                    continue;
+                }
+                const uint32_t position = nextCode[length] - firstCode[length] + firstSymbol[length];
+                lengths[position] = static_cast<uint8_t>(length);
+                symbols[position] = static_cast<uint16_t>(symbol);
+                if (length <= s_fastBits)
+                {
+                    const uint16_t entry = static_cast<uint16_t>((length << 9) | symbol);
+                    for (uint32_t j = Reverse_Bits(nextCode[length], length); j < s_fastSize; j += 1u << length)
+                    {
+                        fast[j] = entry;
+                    }
+                }
+                ++nextCode[length];
+            }
+            return true;
+        }
+    };
+
+    /*
+     * Reads the deflate stream LSB first through a 64 bit buffer.
+     * refill() tops it up to at least 56 bits with a single unaligned load, enough for a whole
+     * length/distance pair, so the decode loop refills once per symbol.
+     */
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data, size_t size, size_t position)
+            : m_data(data), m_size(size), m_position(position)
+        {
+        }
+
+        void refill()
+        {
+            if constexpr (std::endian::native == std::endian::little)
+            {
+                if (m_position + 8 <= m_size)
+                {
+                    uint64_t word;
+                    std::memcpy(&word, m_data + m_position, 8);
+                    m_bits |= word << m_count;
+                    m_position += (63 - m_count) >> 3;
+                    m_count |= 56;
+                    return;
+                }
+            }
+            // near the end, past it the stream reads as zeros and overrun() tells
+            while (m_count < 56)
+            {
+                const uint64_t byte = m_position < m_size ? m_data[m_position] : 0;
+                m_bits |= byte << m_count;
+                ++m_position;
+                m_count += 8;
+            }
+            m_bExhausted = m_position > m_size + 8;
+        }
+
+        uint32_t peek(int count) const { return static_cast<uint32_t>(m_bits & ((1ull << count) - 1)); }
+        void consume(int count) { m_bits >>= count; m_count -= count; }
+        uint32_t read(int count)
+        {
+            const uint32_t value = peek(count);
+            consume(count);
+            return value;
+        }
+
+        // Drops the bits up to the next byte boundary and empties the buffer, bytePosition() is then exact
+        void alignToByte()
+        {
+            consume(m_count & 7);
+            m_position -= m_count >> 3;
+            m_bits = 0;
+            m_count = 0;
+        }
+        size_t bytePosition() const { return m_position - (m_count >> 3); }
+        void skipBytes(size_t count) { m_position += count; }
+        bool overrun() const { return bytePosition() > m_size; }
+        // Far enough past the end that the stream is corrupt, cheap enough to check once per symbol
+        bool exhausted() const { return m_bExhausted; }
+
+    private:
+        const uint8_t* m_data;
+        size_t m_size;
+        size_t m_position; // next byte to load
+        uint64_t m_bits = 0;
+        int m_count = 0;
+        bool m_bExhausted = false;
+    };
+
+    enum class EInflateEnd : unsigned char
+    {
+        Final,   /* the last block was decoded */
+        Flush,   /* stopped at one of the flush points */
+        Error
+    };
+
+    /*
+     * Inflates a raw deflate stream, from its start or from a flush point.
+     * References are only allowed into what this inflater produced, starting at a flush point
+     * that is only correct after a full flush, the caller checks the pieces line up.
+     */
+    class Inflater
+    {
+    public:
+        // The output starts with room for expectedSize bytes and may grow up to maxSize
+        Inflater(const uint8_t* data, size_t size, size_t start, size_t expectedSize, size_t maxSize)
+            : m_data(data), m_size(size), m_reader(data, size, start), m_maxSize(maxSize)
+        {
+            m_output.resize(expectedSize + s_slack);
+        }
+
+        /**
+         * @brief Decodes blocks until the final one or until a stored block ends exactly on a flush point
+         *
+         * @param  flushPoints: sorted byte positions of possible flush points
+         * @param  firstFlushPoint: index of the first flush point that may end this piece
+         * @param  stoppedAt: index of the flush point the piece ended on
+         */
+        EInflateEnd run(const std::vector<size_t>& flushPoints, size_t firstFlushPoint, size_t& stoppedAt)
+        {
+            size_t nextFlushPoint = firstFlushPoint;
+            for (;;)
+            {
+                m_reader.refill();
+                const bool bFinal = m_reader.read(1) != 0;
+                const uint32_t type = m_reader.read(2);
+                bool bOk = false;
+                if (type == 0)
+                {
+                    bOk = storedBlock();
+                    // an empty stored block is what a flush leaves behind
+                    if (bOk && !bFinal)
+                    {
+                        const size_t position = m_reader.bytePosition();
+                        while (nextFlushPoint < flushPoints.size() && flushPoints[nextFlushPoint] < position)
+                        {
+                            ++nextFlushPoint;
+                        }
+                        if (nextFlushPoint < flushPoints.size() && flushPoints[nextFlushPoint] == position)
+                        {
+                            stoppedAt = nextFlushPoint;
+                            finish();
+                            return EInflateEnd::Flush;
+                        }
+                    }
+                }
+                else if (type == 1)
+                {
+                    bOk = fixedTables() && huffmanBlock();
+                }
+                else if (type == 2)
+                {
+                    bOk = dynamicTables() && huffmanBlock();
+                }
+                if (!bOk || m_reader.overrun())
+                {
+                    return EInflateEnd::Error;
+                }
+                if (bFinal)
+                {
+                    finish();
+                    return EInflateEnd::Final;
+                }
+            }
+        }
+
+        std::vector<uint8_t>& output() { return m_output; }
+
+    private:
+        // matches are copied 8 bytes at a time and may write up to 7 bytes past their end
+        static constexpr size_t s_slack = 16;
+
+        void finish() { m_output.resize(m_outputSize); }
+
+        // Makes room for count more bytes, false past the largest output the image can have
+        bool reserve(size_t count)
+        {
+            if (m_outputSize + count + s_slack <= m_output.size())
+            {
+                return true;
+            }
+            if (m_outputSize + count > m_maxSize)
+            {
+                return false;
+            }
+            m_output.resize(std::min(std::max(m_output.size() * 2, m_outputSize + count), m_maxSize) + s_slack);
+            return true;
+        }
+
+        bool storedBlock()
+        {
+            m_reader.alignToByte();
+            const size_t position = m_reader.bytePosition();
+            if (position + 4 > m_size)
+            {
+                return false;
+            }
+            const uint32_t length = m_data[position] | (m_data[position + 1] << 8);
+            const uint32_t inverted = m_data[position + 2] | (m_data[position + 3] << 8);
+            if ((length ^ 0xFFFF) != inverted || position + 4 + length > m_size)
+            {
+                return false;
+            }
+            if (!reserve(length))
+            {
+                return false;
+            }
+            std::memcpy(m_output.data() + m_outputSize, m_data + position + 4, length);
+            m_outputSize += length;
+            m_reader.skipBytes(4 + length);
+            return true;
+        }
+
+        bool fixedTables()
+        {
+            uint8_t lengths[288 + 32];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            std::memset(lengths + 288, 5, 32);
+            return m_literals.build(lengths, 288) && m_distances.build(lengths + 288, 32);
+        }
+
+        bool dynamicTables()
+        {
+            m_reader.refill();
+            const int literalsCount = static_cast<int>(m_reader.read(5)) + 257;
+            const int distancesCount = static_cast<int>(m_reader.read(5)) + 1;
+            const int codeLengthsCount = static_cast<int>(m_reader.read(4)) + 4;
+            uint8_t codeLengthLengths[19] = {};
+            for (int i = 0; i < codeLengthsCount; ++i)
+            {
+                m_reader.refill();
+                codeLengthLengths[s_codeLengthOrder[i]] = static_cast<uint8_t>(m_reader.read(3));
+            }
+            HuffmanTable codeLengths;
+            if (literalsCount > 286 || distancesCount > 30 || !codeLengths.build(codeLengthLengths, 19))
+            {
+                return false;
+            }
+
+            uint8_t lengths[286 + 30];
+            const int total = literalsCount + distancesCount;
+            for (int i = 0; i < total;)
+            {
+                m_reader.refill();
+                int symbol = decodeSymbol(codeLengths);
+                if (symbol < 0)
+                {
+                    return false;
+                }
+                if (symbol < 16)
+                {
+                    lengths[i++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                uint8_t value = 0;
+                int repeat = 0;
+                if (symbol == 16)
+                {
+                    if (i == 0)
+                    {
+                        return false;
+                    }
+                    value = lengths[i - 1];
+                    repeat = 3 + static_cast<int>(m_reader.read(2));
+                }
+                else if (symbol == 17)
+                {
+                    repeat = 3 + static_cast<int>(m_reader.read(3));
+                }
+                else
+                {
+                    repeat = 11 + static_cast<int>(m_reader.read(7));
+                }
+                if (i + repeat > total)
+                {
+                    return false;
+                }
+                std::memset(lengths + i, value, repeat);
+                i += repeat;
+            }
+            return m_literals.build(lengths, literalsCount) && m_distances.build(lengths + literalsCount, distancesCount);
+        }
+
+        // The buffer must hold at least 15 bits, -1 for a code the table does not have
+        int decodeSymbol(const HuffmanTable& table)
+        {
+            const uint16_t entry = table.fast[m_reader.peek(s_fastBits)];
+            if (entry != 0)
+            {
+                m_reader.consume(entry >> 9);
+                return entry & 511;
+            }
+            // long code, compare it MSB first against the last code of every length
+            const uint32_t code = Reverse_Bits(m_reader.peek(16), 16);
+            int length = s_fastBits + 1;
+            while (code >= table.maxCode[length])
+            {
+                ++length;
+            }
+            if (length >= 16)
+            {
+                return -1;
+            }
+            const uint32_t position = (code >> (16 - length)) - table.firstCode[length] + table.firstSymbol[length];
+            if (position >= 288 || table.lengths[position] != length)
+            {
+                return -1;
+            }
+            m_reader.consume(length);
+            return table.symbols[position];
+        }
+
+        bool huffmanBlock()
+        {
+            for (;;)
+            {
+                // 56 bits cover the longest length code, its extra bits, the distance code and its extra bits
+                m_reader.refill();
+                int symbol = decodeSymbol(m_literals);
+                if (symbol < 256)
+                {
+                    if (symbol < 0 || m_reader.exhausted() || !reserve(1))
+                    {
+                        return false;
+                    }
+                    m_output[m_outputSize++] = static_cast<uint8_t>(symbol);
+                    continue;
+                }
+                if (symbol == 256)
+                {
+                    return true;
+                }
+                symbol -= 257;
+                if (symbol >= 29)
+                {
+                    return false;
+                }
+                const uint32_t length = s_lengthBase[symbol] + m_reader.read(s_lengthExtra[symbol]);
+                const int distanceSymbol = decodeSymbol(m_distances);
+                if (distanceSymbol < 0 || distanceSymbol >= 30)
+                {
+                    return false;
+                }
+                const uint32_t distance = s_distanceBase[distanceSymbol] + m_reader.read(s_distanceExtra[distanceSymbol]);
+                if (distance > m_outputSize || m_reader.exhausted() || !reserve(length))
+                {
+                    return false;
+                }
+                uint8_t* destination = m_output.data() + m_outputSize;
+                const uint8_t* source = destination - distance;
+                if (distance >= 8)
+                {
+                    // every 8 byte chunk reads bytes written before it
+                    for (uint32_t i = 0; i < length; i += 8)
+                    {
+                        std::memcpy(destination + i, source + i, 8);
+                    }
+                }
+                else if (distance == 1)
+                {
+                    std::memset(destination, *source, length);
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < length; ++i)
+                    {
+                        destination[i] = source[i];
+                    }
+                }
+                m_outputSize += length;
+            }
+        }
+
+        const uint8_t* m_data;
+        size_t m_size;
+        BitReader m_reader;
+        HuffmanTable m_literals;
+        HuffmanTable m_distances;
+        std::vector<uint8_t> m_output;
+        size_t m_outputSize = 0;
+        size_t m_maxSize;
+    };
+
+    // Byte positions right after every 00 00 FF FF(the LEN/NLEN of an empty stored block), spread over the stream
+    std::vector<size_t> Find_Flush_Points(const uint8_t* data, size_t size, size_t piecesCount)
+    {
+        std::vector<size_t> points;
+        const size_t pieceSize = std::max(size / piecesCount, s_parallelMinSegment);
+        size_t target = pieceSize;
+        for (size_t i = 4; i + 4 <= size && target < size; ++i)
+        {
+            if (i < target)
+            {
+                // jump close to the next split
+                i = target;
+            }
+            if (data[i - 4] == 0 && data[i - 3] == 0 && data[i - 2] == 0xFF && data[i - 1] == 0xFF)
+            {
+                points.push_back(i);
+                target = i + pieceSize;
+            }
+        }
+        return points;
+    }
+
+    /*
+     * Inflates the zlib stream of the IDAT chunks. Large streams with flush points are split there and
+     * inflated in parallel, if a piece turns out not to start at a real flush point(or to refer back past it)
+     * the whole stream is inflated again in one piece.
+     * On a thread pool worker the stream is inflated in one piece, the pool already keeps the cores busy and
+     * every worker starting its own threads would oversubscribe them.
+     */
+    bool Inflate_Zlib(const uint8_t* stream, size_t size, size_t expectedSize, std::vector<uint8_t>& output)
+    {
+        if (size < 2 || (stream[0] & 0x0F) != 8 || ((stream[0] << 8) | stream[1]) % 31 != 0 || (stream[1] & 0x20))
+        {
+            return false; // not deflate or needs a preset dictionary
+        }
+        const uint8_t* data = stream + 2;
+        size = size - 2;
+
+        const size_t threadsCount = ThreadPool::Is_Worker_Thread() ? 1 : std::max(1u, std::thread::hardware_concurrency());
+        const std::vector<size_t> flushPoints = (size >= s_parallelMinBytes && threadsCount > 1) ? Find_Flush_Points(data, size, threadsCount)
+                                                                                                  : std::vector<size_t>();
+        if (!flushPoints.empty())
+        {
+            // piece 0 starts at the stream, piece k > 0 at flushPoints[k - 1]
+            const size_t piecesCount = flushPoints.size() + 1;
+            std::vector<EInflateEnd> ends(piecesCount, EInflateEnd::Error);
+            std::vector<size_t> stoppedAt(piecesCount, 0);
+            std::vector<std::vector<uint8_t>> pieces(piecesCount);
+            auto inflatePiece = [&](size_t piece)
+            {
+                Inflater inflater(data, size, piece == 0 ? 0 : flushPoints[piece - 1], expectedSize / piecesCount, expectedSize);
+                ends[piece] = inflater.run(flushPoints, piece, stoppedAt[piece]);
+                pieces[piece] = std::move(inflater.output());
+            };
+            std::vector<std::thread> threads;
+            threads.reserve(piecesCount - 1);
+            size_t started = 1;
+            try
+            {
+                for (; started < piecesCount; ++started)
+                {
+                    threads.emplace_back(inflatePiece, started);
+                }
+            }
+            catch (const std::system_error&)
+            {
+                // out of threads, the pieces not started yet are inflated here
+            }
+            inflatePiece(0);
+            for (size_t piece = started; piece < piecesCount; ++piece)
+            {
+                inflatePiece(piece);
+            }
+            for (std::thread& thread : threads)
+            {
+                thread.join();
+            }
+
+            // Follow the chain from piece 0, a piece that ran past a false flush point skips the piece started there
+            output.clear();
+            output.reserve(expectedSize);
+            bool bChained = false;
+            for (size_t piece = 0; ends[piece] != EInflateEnd::Error;)
+            {
+                output.insert(output.end(), pieces[piece].begin(), pieces[piece].end());
+                if (ends[piece] == EInflateEnd::Final)
+                {
+                    bChained = true;
+                    break;
+                }
+                piece = stoppedAt[piece] + 1;
+            }
+            if (bChained && output.size() == expectedSize)
+            {
+                return true;
+            }
+        }
+
+        size_t stoppedAt = 0;
+        Inflater inflater(data, size, 0, expectedSize, expectedSize);
+        if (inflater.run({}, 0, stoppedAt) != EInflateEnd::Final)
+        {
+            return false;
+        }
+        output = std::move(inflater.output());
+        return output.size() == expectedSize;
+    }
+
+    inline uint8_t Paeth(uint8_t a, uint8_t b, uint8_t c)
+    {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+        {
+            return a;
+        }
+        return pb <= pc ? b : c;
+    }
+
+    // Undoes the filter of one row in place, previous is the row above after unfiltering(zeros for the first row)
+    void Unfilter_Row_Scalar(uint8_t filter, uint8_t* row, const uint8_t* previous, size_t length, int bpp)
+    {
+        switch (filter)
+        {
+            case 1: // Sub
+                for (size_t i = bpp; i < length; ++i) { row[i] = static_cast<uint8_t>(row[i] + row[i - bpp]); }
+                break;
+            case 2: // Up
+                for (size_t i = 0; i < length; ++i) { row[i] = static_cast<uint8_t>(row[i] + previous[i]); }
+                break;
+            case 3: // Avg
+                for (int i = 0; i < bpp; ++i) { row[i] = static_cast<uint8_t>(row[i] + (previous[i] >> 1)); }
+                for (size_t i = bpp; i < length; ++i) { row[i] = static_cast<uint8_t>(row[i] + ((row[i - bpp] + previous[i]) >> 1)); }
+                break;
+            case 4: // Paeth
+                for (int i = 0; i < bpp; ++i) { row[i] = static_cast<uint8_t>(row[i] + previous[i]); }
+                for (size_t i = bpp; i < length; ++i) { row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - bpp], previous[i], previous[i - bpp])); }
+                break;
+            default:
+                break;
+        }
+    }
+
+#if defined(__SSE2__)
+    // 3 or 4 byte pixels in the low lanes of a register
+    template <int Bpp>
+    inline __m128i Load_Pixel(const uint8_t* p)
+    {
+        int32_t value = 0;
+        std::memcpy(&value, p, Bpp);
+        return _mm_cvtsi32_si128(value);
+    }
+
+    template <int Bpp>
+    inline void Store_Pixel(uint8_t* p, __m128i pixel)
+    {
+        const int32_t value = _mm_cvtsi128_si32(pixel);
+        std::memcpy(p, &value, Bpp);
+    }
+
+    // Whole pixels per instruction, the filters only depend on the previous pixel and the row above
+    template <int Bpp>
+    void Unfilter_Row_Sse2(uint8_t filter, uint8_t* row, const uint8_t* previous, size_t length)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        switch (filter)
+        {
+            case 1: // Sub
+            {
+                __m128i a = zero;
+                for (size_t i = 0; i < length; i += Bpp)
+                {
+                    a = _mm_add_epi8(a, Load_Pixel<Bpp>(row + i));
+                    Store_Pixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 2: // Up
+            {
+                size_t i = 0;
+                for (; i + 16 <= length; i += 16)
+                {
+                    const __m128i sum = _mm_add_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i)),
+                                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i)));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), sum);
+                }
+                for (; i < length; ++i) { row[i] = static_cast<uint8_t>(row[i] + previous[i]); }
+                break;
+            }
+            case 3: // Avg, _mm_avg_epu8 rounds up so the odd sums are corrected down
+            {
+                const __m128i ones = _mm_set1_epi8(1);
+                __m128i a = zero;
+                for (size_t i = 0; i < length; i += Bpp)
+                {
+                    const __m128i b = Load_Pixel<Bpp>(previous + i);
+                    __m128i average = _mm_avg_epu8(a, b);
+                    average = _mm_sub_epi8(average, _mm_and_si128(_mm_xor_si128(a, b), ones));
+                    a = _mm_add_epi8(Load_Pixel<Bpp>(row + i), average);
+                    Store_Pixel<Bpp>(row + i, a);
+                }
+                break;
+            }
+            case 4: // Paeth in 16 bit lanes
+            {
+                __m128i a = zero;
+                __m128i c = zero;
+                for (size_t i = 0; i < length; i += Bpp)
+                {
+                    const __m128i b = _mm_unpacklo_epi8(Load_Pixel<Bpp>(previous + i), zero);
+                    __m128i d = _mm_unpacklo_epi8(Load_Pixel<Bpp>(row + i), zero);
+                    __m128i pa = _mm_sub_epi16(b, c);  // p - a
+                    __m128i pb = _mm_sub_epi16(a, c);  // p - b
+                    __m128i pc = _mm_add_epi16(pa, pb); // p - c
+                    pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+                    pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+                    pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+                    const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                    // a on ties with anything, then b, then c
+                    const __m128i bIsSmallest = _mm_cmpeq_epi16(smallest, pb);
+                    __m128i nearest = _mm_or_si128(_mm_and_si128(bIsSmallest, b), _mm_andnot_si128(bIsSmallest, c));
+                    const __m128i aIsSmallest = _mm_cmpeq_epi16(smallest, pa);
+                    nearest = _mm_or_si128(_mm_and_si128(aIsSmallest, a), _mm_andnot_si128(aIsSmallest, nearest));
+                    // the high bytes of the lanes are 0 and stay 0, the low bytes wrap like the filter wants
+                    d = _mm_add_epi8(d, nearest);
+                    Store_Pixel<Bpp>(row + i, _mm_packus_epi16(d, d));
+                    c = b;
+                    a = d;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+#endif
+
+    bool Unfilter(uint8_t* raw, int width, int height, int bpp)
+    {
+        const size_t length = static_cast<size_t>(width) * bpp;
+        const std::vector<uint8_t> zeros(length, 0);
+        const uint8_t* previous = zeros.data();
+        for (int y = 0; y < height; ++y)
+        {
+            uint8_t* line = raw + static_cast<size_t>(y) * (length + 1);
+            const uint8_t filter = line[0];
+            uint8_t* row = line + 1;
+            if (filter > 4)
+            {
+                return false;
+            }
+#if defined(__SSE2__)
+            if (bpp == 4)
+            {
+                Unfilter_Row_Sse2<4>(filter, row, previous, length);
+            }
+            else if (bpp == 3)
+            {
+                Unfilter_Row_Sse2<3>(filter, row, previous, length);
+            }
+            else
+#endif
+            {
+                Unfilter_Row_Scalar(filter, row, previous, length, bpp);
+            }
+            previous = row;
+        }
+        return true;
+    }
+
+    inline uint32_t Read_Be32(const uint8_t* p)
+    {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+    }
+}
+
+unsigned char* Png_Load(const uint8_t* file, size_t size, int* width, int* height, int* channels, int desiredChannels, bool bFlipVertically)
+{
+    static constexpr uint8_t s_signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size < 8 + 25 || std::memcmp(file, s_signature, 8) != 0)
+    {
+        return nullptr;
+    }
+
+    // Chunks, IHDR must come first
+    uint32_t imageWidth = 0, imageHeight = 0;
+    int fileChannels = 0;
+    std::vector<std::pair<const uint8_t*, size_t>> idats;
+    size_t idatSize = 0;
+    bool bEnd = false;
+    for (size_t position = 8; position + 12 <= size && !bEnd;)
+    {
+        const uint32_t length = Read_Be32(file + position);
+        const uint8_t* type = file + position + 4;
+        const uint8_t* data = file + position + 8;
+        if (length > size - position - 12)
+        {
+            return nullptr;
+        }
+        if (position == 8)
+        {
+            // 8 bit depth, no interlacing, color types 0(grey), 2(RGB), 4(grey alpha) and 6(RGBA)
+            static constexpr int s_channelsOfType[7] = {1, 0, 3, 0, 2, 0, 4};
+            if (std::memcmp(type, "IHDR", 4) != 0 || length != 13 || data[8] != 8 || data[9] > 6 || s_channelsOfType[data[9]] == 0 ||
+                data[10] != 0 || data[11] != 0 || data[12] != 0)
+            {
+                return nullptr;
+            }
+            imageWidth = Read_Be32(data);
+            imageHeight = Read_Be32(data + 4);
+            fileChannels = s_channelsOfType[data[9]];
+        }
+        else if (std::memcmp(type, "IDAT", 4) == 0)
+        {
+            idats.emplace_back(data, length);
+            idatSize += length;
+        }
+        else if (std::memcmp(type, "tRNS", 4) == 0)
+        {
+            return nullptr; // color key transparency is left to stb_image
+        }
+        else if (std::memcmp(type, "IEND", 4) == 0)
+        {
+            bEnd = true;
+        }
+        position += 12 + length;
+    }
+    const uint64_t pixelsCount = static_cast<uint64_t>(imageWidth) * imageHeight;
+    if (imageWidth == 0 || imageHeight == 0 || imageWidth > (1u << 24) || imageHeight > (1u << 24) || pixelsCount > (1ull << 28) || idats.empty())
+    {
+        return nullptr;
+    }
+    const int outputChannels = desiredChannels == 0 ? fileChannels : desiredChannels;
+    if (outputChannels < fileChannels || outputChannels > 4)
+    {
+        return nullptr;
+    }
+
+    // The zlib stream continues across IDAT chunks, one chunk is used in place
+    std::vector<uint8_t> joined;
+    const uint8_t* stream = idats[0].first;
+    if (idats.size() > 1)
+    {
+        joined.reserve(idatSize);
+        for (const auto& [data, length] : idats)
+        {
+            joined.insert(joined.end(), data, data + length);
+        }
+        stream = joined.data();
+    }
+
+    const size_t rowLength = static_cast<size_t>(imageWidth) * fileChannels;
+    std::vector<uint8_t> raw;
+    if (!Inflate_Zlib(stream, idatSize, (rowLength + 1) * imageHeight, raw) ||
+        !Unfilter(raw.data(), static_cast<int>(imageWidth), static_cast<int>(imageHeight), fileChannels))
+    {
+        return nullptr;
+    }
+
+    const size_t outputRowLength = static_cast<size_t>(imageWidth) * outputChannels;
+    unsigned char* pixels = static_cast<unsigned char*>(std::malloc(outputRowLength * imageHeight));
+    if (!pixels)
+    {
+        return nullptr;
+    }
+    for (uint32_t y = 0; y < imageHeight; ++y)
+    {
+        const uint8_t* source = raw.data() + static_cast<size_t>(y) * (rowLength + 1) + 1;
+        uint8_t* destination = pixels + static_cast<size_t>(bFlipVertically ? imageHeight - 1 - y : y) * outputRowLength;
+        if (outputChannels == fileChannels)
+        {
+            std::memcpy(destination, source, rowLength);
+            continue;
+        }
+        // Expand like stb_image: grey to RGB, opaque alpha where the file has none
+        for (uint32_t x = 0; x < imageWidth; ++x)
+        {
+            const uint8_t* in = source + static_cast<size_t>(x) * fileChannels;
+            uint8_t* out = destination + static_cast<size_t>(x) * outputChannels;
+            const bool bGrey = fileChannels <= 2;
+            const uint8_t alpha = (fileChannels == 2 || fileChannels == 4) ? in[fileChannels - 1] : 255;
+            if (outputChannels <= 2)
+            {
+                out[0] = in[0];
+            }
+            else
+            {
+                out[0] = in[0];
+                out[1] = bGrey ? in[0] : in[1];
+                out[2] = bGrey ? in[0] : in[2];
+            }
+            if (outputChannels == 2 || outputChannels == 4)
+            {
+                out[outputChannels - 1] = alpha;
+            }
+        }
+    }
+
+    *width = static_cast<int>(imageWidth);
+    *height = static_cast<int>(imageHeight);
+    *channels = fileChannels;
+    return pixels;
+}
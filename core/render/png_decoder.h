@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * PNG decoder for the images our assets actually use: 8 bit grey, grey+alpha, RGB and RGBA, not interlaced.
+ * Texture::decode tries it first and falls back to stb_image for everything else(palettes, 16 bit, interlacing,
+ * tRNS color keys) and for files it can not decode.
+ *
+ * Compared to stb_image:
+ * - inflate refills a 64 bit bit buffer with one unaligned load and decodes most Huffman codes with
+ *   one table lookup, matches are copied 8 bytes at a time
+ * - the Sub/Up/Avg/Paeth row filters are undone with SSE2, a whole pixel per instruction
+ * - large images whose encoder made full flushes(empty stored blocks after which nothing refers back)
+ *   are inflated in parallel from every flush point, the pieces are checked to line up before use(not on
+ *   thread pool workers, and serially when no more threads can be started)
+ * - the vertical flip is a parameter of the call instead of global state
+ *
+ * Example usage:
+ * @code
+ * int width, height, channels;
+ * unsigned char* pixels = Png_Load(file.data(), file.size(), &width, &height, &channels, 4, true);
+ * if (!pixels) { ... stbi_load_from_memory ... }
+ * std::free(pixels);
+ * @endcode
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Decodes a PNG file held in memory, same contract as stbi_load_from_memory
+ *
+ * @param  file, size: the whole file
+ * @param  width, height: size of the image
+ * @param  channels: channels stored in the file(also when desiredChannels converts them)
+ * @param  desiredChannels: 0 keeps the channels of the file, otherwise 1 to 4. Only expanding is supported.
+ * @param  bFlipVertically: bottom row first, the order OpenGL expects
+ *
+ * @return unsigned char*: tightly packed pixels allocated with malloc(free them with std::free),
+ *         null if the file is not a PNG this decoder handles
+ */
+unsigned char* Png_Load(const uint8_t* file, size_t size, int* width, int* height, int* channels, int desiredChannels, bool bFlipVertically);
@@ -0,0 +1,307 @@
+#include "render_graph.h"
+
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <queue>
+
+RenderGraph::RenderGraph()
+{
+}
+
+RenderGraph::~RenderGraph()
+{
+    for (const PhysicalTarget& target : m_physical)
+    {
+        glDeleteFramebuffers(1, &target.framebuffer);
+        glDeleteTextures(1, &target.texture);
+    }
+}
+
+RenderResource RenderGraph::createTarget(const std::string& name, const RenderTargetDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    m_resources.push_back(std::move(resource));
+    return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+RenderResource RenderGraph::importTarget(const std::string& name, unsigned int framebuffer, unsigned int texture, int width, int height)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc.width = width;
+    resource.desc.height = height;
+    resource.bImported = true;
+    resource.framebuffer = framebuffer;
+    resource.texture = texture;
+    m_resources.push_back(std::move(resource));
+    return static_cast<RenderResource>(m_resources.size() - 1);
+}
+
+void RenderGraph::resizeImported(RenderResource resource, int width, int height)
+{
+    Resource& target = m_resources[resource];
+    if (target.bImported)
+    {
+        target.desc.width = width;
+        target.desc.height = height;
+    }
+}
+
+void RenderGraph::addPass(const std::string& name, const std::vector<RenderResource>& reads, const std::vector<RenderResource>& writes, ExecuteFunc execute)
+{
+    m_passes.push_back({name, reads, writes, std::move(execute)});
+}
+
+bool RenderGraph::compile()
+{
+    const uint32_t passesCount = static_cast<uint32_t>(m_passes.size());
+    m_order.clear();
+    m_discards.clear();
+
+    // 1. Dependencies, declaration order decides between passes touching the same resource.
+    // A read depends on the writes declared before it, or on all writes if it was declared first.
+    // Only these make a pass needed, a pass that merely has to wait for a reader(write after read) is ordered in step 3.
+    std::vector<std::vector<uint32_t>> writers(m_resources.size());
+    std::vector<std::vector<uint32_t>> readers(m_resources.size());
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        for (RenderResource r : m_passes[p].writes) { writers[r].push_back(p); }
+        for (RenderResource r : m_passes[p].reads) { readers[r].push_back(p); }
+    }
+    std::vector<std::vector<uint32_t>> dependencies(passesCount);
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        const Pass& pass = m_passes[p];
+        for (RenderResource r : pass.reads)
+        {
+            bool bEarlierWriter = false;
+            for (uint32_t w : writers[r])
+            {
+                if (w < p) { dependencies[p].push_back(w); bEarlierWriter = true; }
+            }
+            if (!bEarlierWriter)
+            {
+                for (uint32_t w : writers[r]) { if (w != p) { dependencies[p].push_back(w); } }
+            }
+        }
+        for (RenderResource r : pass.writes)
+        {
+            // writes to the same target keep their declaration order
+            for (uint32_t w : writers[r])
+            {
+                if (w < p) { dependencies[p].push_back(w); }
+            }
+        }
+    }
+
+    // 2. Culling, only passes that end up in an imported target are needed
+    std::vector<bool> alive(passesCount, false);
+    std::vector<uint32_t> stack;
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        for (RenderResource r : m_passes[p].writes)
+        {
+            if (m_resources[r].bImported && !alive[p])
+            {
+                alive[p] = true;
+                stack.push_back(p);
+            }
+        }
+    }
+    while (!stack.empty())
+    {
+        uint32_t p = stack.back();
+        stack.pop_back();
+        for (uint32_t dependency : dependencies[p])
+        {
+            if (!alive[dependency])
+            {
+                alive[dependency] = true;
+                stack.push_back(dependency);
+            }
+        }
+    }
+
+    // 3. Ordering(Kahn), ties are broken by declaration order so the result is deterministic.
+    // An alive pass must not overwrite a target before the alive passes reading it earlier are done with it.
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        if (!alive[p]) { continue; }
+        for (RenderResource r : m_passes[p].writes)
+        {
+            for (uint32_t reader : readers[r])
+            {
+                bool bReaderDependsOnUs = std::find(dependencies[reader].begin(), dependencies[reader].end(), p) != dependencies[reader].end();
+                if (reader < p && alive[reader] && !bReaderDependsOnUs) { dependencies[p].push_back(reader); }
+            }
+        }
+    }
+    std::vector<uint32_t> pending(passesCount, 0);
+    std::vector<std::vector<uint32_t>> dependents(passesCount);
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        if (!alive[p]) { continue; }
+        std::sort(dependencies[p].begin(), dependencies[p].end());
+        dependencies[p].erase(std::unique(dependencies[p].begin(), dependencies[p].end()), dependencies[p].end());
+        pending[p] = static_cast<uint32_t>(dependencies[p].size());
+        for (uint32_t dependency : dependencies[p]) { dependents[dependency].push_back(p); }
+    }
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    uint32_t aliveCount = 0;
+    for (uint32_t p = 0; p < passesCount; ++p)
+    {
+        if (!alive[p]) { continue; }
+        ++aliveCount;
+        if (pending[p] == 0) { ready.push(p); }
+    }
+    while (!ready.empty())
+    {
+        uint32_t p = ready.top();
+        ready.pop();
+        m_order.push_back(p);
+        for (uint32_t dependent : dependents[p])
+        {
+            if (--pending[dependent] == 0) { ready.push(dependent); }
+        }
+    }
+    if (m_order.size() != aliveCount)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "RenderGraph: dependency cycle between passes, graph not compiled");
+        m_order.clear();
+        return false;
+    }
+
+    // 4. Lifetimes of the transient targets in execution order
+    std::vector<int> firstUse(m_resources.size(), -1);
+    std::vector<int> lastUse(m_resources.size(), -1);
+    for (int i = 0; i < static_cast<int>(m_order.size()); ++i)
+    {
+        const Pass& pass = m_passes[m_order[i]];
+        auto touch = [&](RenderResource r)
+        {
+            if (firstUse[r] == -1) { firstUse[r] = i; }
+            lastUse[r] = i;
+        };
+        std::for_each(pass.reads.begin(), pass.reads.end(), touch);
+        std::for_each(pass.writes.begin(), pass.writes.end(), touch);
+    }
+
+    // 5. Aliasing, greedy by first use: a target reuses memory whose previous user is already done
+    std::vector<RenderResource> transients;
+    for (RenderResource r = 0; r < m_resources.size(); ++r)
+    {
+        m_resources[r].physical = -1;
+        if (!m_resources[r].bImported && firstUse[r] != -1) { transients.push_back(r); }
+    }
+    std::sort(transients.begin(), transients.end(), [&](RenderResource a, RenderResource b) { return firstUse[a] < firstUse[b]; });
+    for (PhysicalTarget& target : m_physical)
+    {
+        target.lastUse = -1;
+    }
+    m_discards.resize(m_order.size());
+    for (RenderResource r : transients)
+    {
+        int physical = acquirePhysical(m_resources[r].desc, firstUse[r]);
+        m_physical[physical].lastUse = lastUse[r];
+        m_resources[r].physical = physical;
+        m_resources[r].framebuffer = m_physical[physical].framebuffer;
+        m_resources[r].texture = m_physical[physical].texture;
+        m_discards[lastUse[r]].push_back(r);
+    }
+
+    // Memory left over from a previous compile that nothing uses anymore
+    for (size_t i = 0; i < m_physical.size(); ++i)
+    {
+        if (m_physical[i].lastUse != -1) { continue; }
+        glDeleteFramebuffers(1, &m_physical[i].framebuffer);
+        glDeleteTextures(1, &m_physical[i].texture);
+        m_physical.erase(m_physical.begin() + i);
+        for (Resource& resource : m_resources)
+        {
+            if (resource.physical > static_cast<int>(i)) { --resource.physical; }
+        }
+        --i;
+    }
+
+    Debug_Log(ELogCategory::Core, "RenderGraph: ", m_order.size(), "/", passesCount, " passes, ",
+              transients.size(), " transient targets in ", m_physical.size(), " textures");
+    return true;
+}
+
+int RenderGraph::acquirePhysical(const RenderTargetDesc& desc, int firstUse)
+{
+    for (size_t i = 0; i < m_physical.size(); ++i)
+    {
+        if (m_physical[i].desc == desc && m_physical[i].lastUse < firstUse)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    PhysicalTarget target;
+    target.desc = desc;
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, desc.internalFormat, desc.width, desc.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "RenderGraph: render target framebuffer is not complete");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    m_physical.push_back(target);
+    return static_cast<int>(m_physical.size() - 1);
+}
+
+void RenderGraph::execute() const
+{
+    // Invalidating a target after its last use saves writing it back to memory on tiled GPUs
+    const bool bCanInvalidate = GLAD_GL_VERSION_4_3;
+    const GLenum attachment = GL_COLOR_ATTACHMENT0;
+
+    for (size_t i = 0; i < m_order.size(); ++i)
+    {
+        const Pass& pass = m_passes[m_order[i]];
+        if (!pass.writes.empty())
+        {
+            const Resource& target = m_resources[pass.writes.front()];
+            glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+            glViewport(0, 0, target.desc.width, target.desc.height);
+        }
+        pass.execute(*this);
+
+        if (bCanInvalidate)
+        {
+            for (RenderResource r : m_discards[i])
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, m_resources[r].framebuffer);
+                glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &attachment);
+            }
+        }
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::reset()
+{
+    m_resources.clear();
+    m_passes.clear();
+    m_order.clear();
+    m_discards.clear();
+}
+
+unsigned int RenderGraph::getTexture(RenderResource resource) const
+{
+    return m_resources[resource].texture;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+/*
+ * Declarative description of a frame. Passes declare which render targets they read and write,
+ * the graph then culls passes whose results are never used, orders the rest by their dependencies
+ * and lets transient targets with non-overlapping lifetimes share the same GL texture.
+ *
+ * Imported targets(the default framebuffer for example) are owned outside of the graph.
+ * Writing to one of them is what keeps a pass alive, everything else is kept only if an alive pass needs it.
+ *
+ * Example usage:
+ * @code
+ * RenderGraph graph;
+ * RenderResource backbuffer = graph.importTarget("Backbuffer", 0, 0, 1080, 720);
+ * RenderResource scene = graph.createTarget("SceneColor", {1080, 720});
+ * graph.addPass("Sprites", {}, {scene}, [](const RenderGraph&){ ... });
+ * graph.addPass("Present", {scene}, {backbuffer}, [scene](const RenderGraph& g){ glBindTexture(GL_TEXTURE_2D, g.getTexture(scene)); ... });
+ * graph.compile();
+ * graph.execute(); // every frame
+ * @endcode
+ */
+
+#include <glad/gl.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+using RenderResource = uint32_t;
+
+/* Description of a transient target, targets alias only when their descriptions match */
+struct RenderTargetDesc
+{
+    int width{0};
+    int height{0};
+    GLenum internalFormat{GL_RGBA8};
+
+    bool operator==(const RenderTargetDesc& other) const = default;
+};
+
+class RenderGraph
+{
+public:
+    using ExecuteFunc = std::function<void(const RenderGraph&)>;
+
+    RenderGraph();
+    ~RenderGraph();
+
+    // Transient target, its memory is created and aliased by the graph
+    RenderResource createTarget(const std::string& name, const RenderTargetDesc& desc);
+    // Target owned outside of the graph, for the default framebuffer pass 0 as framebuffer and texture
+    RenderResource importTarget(const std::string& name, unsigned int framebuffer, unsigned int texture, int width, int height);
+    // New size of an imported target(the window was resized), used for the viewport from the next execute() on, no compile() needed
+    void resizeImported(RenderResource resource, int width, int height);
+
+    // Declares a pass, execute is called with the target of the first write bound as the framebuffer
+    void addPass(const std::string& name, const std::vector<RenderResource>& reads, const std::vector<RenderResource>& writes, ExecuteFunc execute);
+
+    // Culls, orders and assigns memory, returns false on a dependency cycle
+    bool compile();
+    // Runs the compiled passes in order
+    void execute() const;
+    // Removes all passes and resources, the GL memory is kept for the next compile()
+    void reset();
+
+    // GL texture behind a resource, valid after compile()
+    unsigned int getTexture(RenderResource resource) const;
+    // Number of GL textures the transient targets were packed into
+    size_t getPhysicalTargetsCount() const { return m_physical.size(); }
+
+private:
+    struct Resource
+    {
+        std::string name;
+        RenderTargetDesc desc;
+        bool bImported{false};
+        unsigned int framebuffer{0};
+        unsigned int texture{0};
+        // index into m_physical, transient targets only
+        int physical{-1};
+    };
+
+    struct Pass
+    {
+        std::string name;
+        std::vector<RenderResource> reads;
+        std::vector<RenderResource> writes;
+        ExecuteFunc execute;
+    };
+
+    struct PhysicalTarget
+    {
+        RenderTargetDesc desc;
+        unsigned int framebuffer{0};
+        unsigned int texture{0};
+        // last pass(in execution order) using it during the current assignment
+        int lastUse{-1};
+    };
+
+    int acquirePhysical(const RenderTargetDesc& desc, int firstUse);
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    // alive passes in execution order, filled by compile()
+    std::vector<uint32_t> m_order;
+    // transient targets to invalidate after each entry of m_order
+    std::vector<std::vector<RenderResource>> m_discards;
+    std::vector<PhysicalTarget> m_physical;
+};
@@ -1,5 +1,13 @@
 #include "renderer2D.h"
 #include "basic_texture.h"
+#include "software_rasterizer.h"
+
+#include <debug_logger_component.h>
+#include <file_watcher_component.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
 
 // IMPORTANT define: This tells the compiler to include the implementation of stb_image
 #ifndef STB_IMAGE_IMPLEMENTATION
@@ -7,39 +15,182 @@
 #endif
 #include <stb_image.h>
 
+Renderer2D::Renderer2D()
+{
+}
+
 Renderer2D::~Renderer2D()
 {
+    if (m_backend == ERenderBackend::Software)
+    {
+        return; // nothing was created in OpenGL
+    }
     // Clean up resources
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    if (m_bMultiDraw)
+    {
+        glDeleteBuffers(1, &m_slotBuffer);
+        glDeleteBuffers(1, &m_indirectBuffer);
+    }
 }
 
 bool Renderer2D::Init(const char* vertexShaderPath, const char* fragmentShaderPath, const glm::mat4& projection)
 {
-    m_shader = Shader(vertexShaderPath, fragmentShaderPath);
-    // Initialize the shader and set projection matrix
-    m_shader.use();
-    m_shader.setMat4("uProjection", projection);
+    // The variants nearly every frame uses, the rest compile on their first draw.
+    // They compile in parallel in the driver while the application loads its assets.
+    const std::initializer_list<uint32_t> commonVariants = {
+        SHADER_VARIANT_TEXTURED,
+        SHADER_VARIANT_TEXTURED | SHADER_VARIANT_TINTED,
+        SHADER_VARIANT_TINTED
+    };
+
+    // Multi draw needs base instance and sampler array indexing as well, both are core in 4.2
+    if (GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_VERSION_4_2))
+    {
+        // The multi draw shaders live next to the regular ones
+        std::filesystem::path directory = std::filesystem::path(vertexShaderPath).parent_path();
+        m_shaders = ShaderVariantCache((directory / "multi_draw_vertex_shader.glsl").string(),
+                                       (directory / "multi_draw_fragment_shader.glsl").string());
+        m_shaders.precompile(commonVariants);
+        // waits for this variant only, the others keep compiling
+        m_bMultiDraw = m_shaders.get(SHADER_VARIANT_TEXTURED).isLinked();
+        if (!m_bMultiDraw)
+        {
+            Debug_Log(ELogCategory::Core, EPrintColor::Yellow, "Multi draw shaders failed, falling back to a draw per batch");
+        }
+    }
+    if (!m_bMultiDraw)
+    {
+        m_shaders = ShaderVariantCache(vertexShaderPath, fragmentShaderPath);
+        m_shaders.precompile(commonVariants);
+    }
+
+    if (m_bMultiDraw)
+    {
+        GLint textureUnits = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+        m_textureSlots = std::min(s_maxTextureSlots, static_cast<uint32_t>(textureUnits));
+    }
+
+    m_projection = projection;
+    m_uniformsApplied = 0;
     initRenderData();
     return true; // success
 }
 
-void Renderer2D::initRenderData()
+Shader& Renderer2D::useVariant(uint32_t variant)
 {
-    // Define quad vertices and texture coordinates
-    float vertices[] = {
-        // positions   // texture coords
-         0.5f,  0.5f,  1.0f, 1.0f, // top right
-         0.5f, -0.5f,  1.0f, 0.0f, // bottom right
-        -0.5f, -0.5f,  0.0f, 0.0f, // bottom left
-        -0.5f,  0.5f,  0.0f, 1.0f  // top left
-    };
+    Shader& shader = m_shaders.get(variant);
+    shader.use();
+    if (!(m_uniformsApplied & (1u << variant)))
+    {
+        applyShaderUniforms(shader, variant);
+        m_uniformsApplied |= 1u << variant;
+    }
+    return shader;
+}
 
-    unsigned int indices[] = {
-        0, 1, 3, // first triangle
-        1, 2, 3  // second triangle
-    };
+void Renderer2D::applyShaderUniforms(Shader& shader, uint32_t variant)
+{
+    shader.setMat4("uProjection"_uniform, m_projection);
+    if (m_bMultiDraw)
+    {
+        for (uint32_t slot = 0; slot < m_textureSlots; ++slot)
+        {
+            shader.setInt("uTextures[" + std::to_string(slot) + "]", slot);
+        }
+    }
+    if (variant & SHADER_VARIANT_LIT)
+    {
+        shader.setVec3("uAmbientLight"_uniform, m_ambientLight);
+        shader.setVec2("uLightPosition"_uniform, m_lightPosition);
+        shader.setVec3("uLightColor"_uniform, m_lightColor);
+        shader.setFloat("uLightRadius"_uniform, m_lightRadius);
+    }
+}
+
+void Renderer2D::setLight(const glm::vec2& position, const glm::vec3& color, float radius, const glm::vec3& ambient)
+{
+    if (m_backend == ERenderBackend::Software)
+    {
+        return;
+    }
+    // Quads already batched were meant to be lit by the old light
+    flush();
+    m_lightPosition = position;
+    m_lightColor = color;
+    m_lightRadius = radius;
+    m_ambientLight = ambient;
+    for (uint32_t variant = 0; variant < SHADER_VARIANT_COUNT; ++variant)
+    {
+        if (variant & SHADER_VARIANT_LIT)
+        {
+            m_uniformsApplied &= ~(1u << variant);
+        }
+    }
+}
+
+void Renderer2D::enableShaderHotReload()
+{
+    if (m_backend == ERenderBackend::Software || m_shaderWatcher)
+    {
+        return;
+    }
+    m_shaderWatcher = std::make_unique<FileWatcher>();
+    m_shaders.watchSources(*m_shaderWatcher);
+}
+
+bool Renderer2D::InitSoftware(int width, int height, const glm::mat4& projection)
+{
+    m_backend = ERenderBackend::Software;
+    m_rasterizer = std::make_unique<SoftwareRasterizer>(width, height, projection);
+    return true; // success
+}
+
+void Renderer2D::beginFrame(const glm::vec4& clearColor)
+{
+    if (m_backend == ERenderBackend::Software)
+    {
+        m_rasterizer->clear(clearColor);
+        return;
+    }
+    // Variants started by precompile() finish in the background, get() only waits for the ones drawn
+    m_shaders.pollBuilds();
+    m_uniformsApplied &= ~m_shaders.pollHotReload();
+    GLint viewport[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    m_viewportSize = glm::vec2(static_cast<float>(viewport[2]), static_cast<float>(viewport[3]));
+    glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void Renderer2D::endFrame()
+{
+    if (m_backend == ERenderBackend::Software)
+    {
+        m_rasterizer->flush();
+        return;
+    }
+    flush();
+}
+
+void Renderer2D::initRenderData()
+{
+    // Quads are built on the CPU every frame, only the indices are static
+    std::vector<unsigned int> indices(s_maxQuads * 6);
+    for (uint32_t quad = 0; quad < s_maxQuads; ++quad)
+    {
+        unsigned int first = quad * 4;
+        indices[quad * 6 + 0] = first + 0; // first triangle
+        indices[quad * 6 + 1] = first + 1;
+        indices[quad * 6 + 2] = first + 3;
+        indices[quad * 6 + 3] = first + 1; // second triangle
+        indices[quad * 6 + 4] = first + 2;
+        indices[quad * 6 + 5] = first + 3;
+    }
+    m_vertices.reserve(s_maxQuads * 4);
 
     // Generate and bind VAO, VBO, and EBO
     glGenVertexArrays(1, &VAO);
@@ -49,38 +200,202 @@ void Renderer2D::initRenderData()
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, s_maxQuads * 4 * sizeof(QuadVertex), nullptr, GL_DYNAMIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
     // Position attribute
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void*)offsetof(QuadVertex, position));
     glEnableVertexAttribArray(0);
 
     // Texture coord attribute
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(QuadVertex), (void*)offsetof(QuadVertex, texCoord));
     glEnableVertexAttribArray(1);
 
+    // Tint attribute, 4 bytes unpacked to [0, 1]
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(QuadVertex), (void*)offsetof(QuadVertex, color));
+    glEnableVertexAttribArray(2);
+
+    if (m_bMultiDraw)
+    {
+        // Texture slot attribute, advances once per instance so a draw reads slot baseInstance
+        uint32_t slots[s_maxTextureSlots];
+        for (uint32_t slot = 0; slot < s_maxTextureSlots; ++slot)
+        {
+            slots[slot] = slot;
+        }
+        glGenBuffers(1, &m_slotBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, m_slotBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(slots), slots, GL_STATIC_DRAW);
+        glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+        glVertexAttribDivisor(3, 1);
+        glEnableVertexAttribArray(3);
+
+        glGenBuffers(1, &m_indirectBuffer);
+    }
+
     glBindVertexArray(0);
 }
 
-void Renderer2D::drawQuad(const glm::vec2& position, const glm::vec2& size, std::shared_ptr<Texture> texture)
+// RGBA8 in memory order, matches the GL_UNSIGNED_BYTE x4 attribute
+static uint32_t Pack_Color(const glm::vec4& color)
 {
-    // Activate the shader
-    m_shader.use();
+    glm::vec4 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return static_cast<uint32_t>(clamped.r) | (static_cast<uint32_t>(clamped.g) << 8) |
+           (static_cast<uint32_t>(clamped.b) << 16) | (static_cast<uint32_t>(clamped.a) << 24);
+}
+
+void Renderer2D::drawQuad(const glm::vec2& position, const glm::vec2& size, const std::shared_ptr<Texture>& texture, const glm::vec4& tint)
+{
+    if (m_backend == ERenderBackend::Software)
+    {
+        if (texture)
+        {
+            texture->markUsed();
+        }
+        m_rasterizer->submitQuad(position, size, texture);
+        return;
+    }
+    // keeps the texture from being evicted, or brings it back if it was, and tells which
+    // mip levels it needs from the on-screen pixels per texel(see TextureBudget)
+    if (texture && texture->width > 0 && texture->height > 0)
+    {
+        const float screenWidth = std::abs(size.x * m_projection[0][0]) * 0.5f * m_viewportSize.x;
+        const float screenHeight = std::abs(size.y * m_projection[1][1]) * 0.5f * m_viewportSize.y;
+        texture->markUsed(std::max(screenWidth / texture->width, screenHeight / texture->height));
+    }
+    else if (texture)
+    {
+        texture->markUsed();
+    }
+    if (m_vertices.size() == s_maxQuads * 4)
+    {
+        flush();
+    }
+
+    const bool bTinted = tint != glm::vec4(1.0f);
+    uint32_t variant = 0;
+    if (texture)                { variant |= SHADER_VARIANT_TEXTURED; }
+    if (bTinted || !texture)    { variant |= SHADER_VARIANT_TINTED; }
+    if (m_bAlphaTest)           { variant |= SHADER_VARIANT_ALPHA_TEST; }
+    if (m_bLighting)            { variant |= SHADER_VARIANT_LIT; }
+    const unsigned int textureId = texture ? texture->ID : 0;
+    const uint32_t color = Pack_Color(tint);
+    // atlas sub textures cover only part of their GL texture
+    const glm::vec2 uvMin = texture ? texture->uvMin : glm::vec2(0.0f);
+    const glm::vec2 uvMax = texture ? texture->uvMax : glm::vec2(1.0f);
 
-    // Model matrix for the quad
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(position, 0.0f));
-    model = glm::scale(model, glm::vec3(size, 1.0f));
-    m_shader.setMat4("uModel", model);
+    // The quad spans [-0.5, 0.5] around position, transformed here instead of with a model matrix
+    const glm::vec2 min = position - size * 0.5f;
+    const glm::vec2 max = position + size * 0.5f;
+    uint32_t quad = static_cast<uint32_t>(m_vertices.size() / 4);
+    m_vertices.push_back({{max.x, max.y}, {uvMax.x, uvMax.y}, color}); // top right
+    m_vertices.push_back({{max.x, min.y}, {uvMax.x, uvMin.y}, color}); // bottom right
+    m_vertices.push_back({{min.x, min.y}, {uvMin.x, uvMin.y}, color}); // bottom left
+    m_vertices.push_back({{min.x, max.y}, {uvMin.x, uvMax.y}, color}); // top left
 
-    // Bind texture using the Texture class
-    texture->bind();
+    if (m_batches.empty() || m_batches.back().texture != textureId || m_batches.back().variant != variant)
+    {
+        m_batches.push_back({textureId, variant, quad, 0});
+    }
+    ++m_batches.back().quadsCount;
+}
+
+void Renderer2D::flush()
+{
+    if (m_batches.empty())
+    {
+        return;
+    }
 
-    // Render the quad
     glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+
+    // Orphan the buffer so the driver does not wait for the previous frame to finish reading it
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, s_maxQuads * 4 * sizeof(QuadVertex), nullptr, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, m_vertices.size() * sizeof(QuadVertex), m_vertices.data());
+
+    if (m_bMultiDraw)
+    {
+        drawBatchesIndirect();
+    }
+    else
+    {
+        drawBatches();
+    }
+
     glBindVertexArray(0);
+    m_vertices.clear();
+    m_batches.clear();
+}
+
+void Renderer2D::drawBatches()
+{
+    glActiveTexture(GL_TEXTURE0);
+    uint32_t currentVariant = SHADER_VARIANT_COUNT;
+    for (const Batch& batch : m_batches)
+    {
+        if (batch.variant != currentVariant)
+        {
+            useVariant(batch.variant);
+            currentVariant = batch.variant;
+        }
+        glBindTexture(GL_TEXTURE_2D, batch.texture);
+        glDrawElements(GL_TRIANGLES, batch.quadsCount * 6, GL_UNSIGNED_INT, (void*)(static_cast<uintptr_t>(batch.firstQuad) * 6 * sizeof(unsigned int)));
+    }
+}
+
+void Renderer2D::drawBatchesIndirect()
+{
+    m_commands.clear();
+    m_groups.clear();
+
+    // Batches keep their order, a group ends when it runs out of texture units or the variant changes
+    for (const Batch& batch : m_batches)
+    {
+        TextureGroup* group = m_groups.empty() ? nullptr : &m_groups.back();
+        const bool bTextured = batch.texture != 0;
+        uint32_t slot = 0;
+        if (group && bTextured)
+        {
+            while (slot < group->texturesCount && group->textures[slot] != batch.texture)
+            {
+                ++slot;
+            }
+        }
+        if (!group || group->variant != batch.variant ||
+            (bTextured && slot == group->texturesCount && group->texturesCount == m_textureSlots))
+        {
+            m_groups.push_back({{}, 0, batch.variant, static_cast<uint32_t>(m_commands.size()), 0});
+            group = &m_groups.back();
+            slot = 0;
+        }
+        // untextured batches never sample, any slot will do
+        if (bTextured && slot == group->texturesCount)
+        {
+            group->textures[group->texturesCount++] = batch.texture;
+        }
+
+        m_commands.push_back({batch.quadsCount * 6, 1, batch.firstQuad * 6, 0, slot});
+        ++group->commandsCount;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+
+    for (const TextureGroup& group : m_groups)
+    {
+        useVariant(group.variant);
+        for (uint32_t slot = 0; slot < group.texturesCount; ++slot)
+        {
+            glActiveTexture(GL_TEXTURE0 + slot);
+            glBindTexture(GL_TEXTURE_2D, group.textures[slot]);
+        }
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                    (void*)(static_cast<uintptr_t>(group.firstCommand) * sizeof(DrawElementsIndirectCommand)),
+                                    group.commandsCount, 0);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
 }
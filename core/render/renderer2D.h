@@ -1,27 +1,139 @@
 #pragma once
 
-#include "basic_shader.h"
+#include "shader_variant_cache.h"
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 class Texture;
+class SoftwareRasterizer;
+class FileWatcher;
 
+/* Where the Renderer2D draws to */
+enum class ERenderBackend : unsigned char
+{
+    OpenGL,
+    Software /* CPU tile rasterizer, does not need a GPU or an OpenGL context */
+};
+
+/*
+ * Quads are not drawn immediately, drawQuad() appends them to a vertex array and consecutive quads
+ * with the same texture and shader variant form a batch. The batches are drawn on endFrame()(or when the array is full).
+ * With GL 4.3/ARB_multi_draw_indirect every group of up to s_maxTextureSlots textures is submitted
+ * with one glMultiDrawElementsIndirect, otherwise every batch is its own glDrawElements.
+ *
+ * The shader variant of a quad follows from what it uses: a texture, a tint, and the alpha test and
+ * lighting state at the time of the call. Only the variants actually drawn get compiled.
+ */
 class Renderer2D
 {
 public:
-    Renderer2D() = default;
+    Renderer2D();
     ~Renderer2D();
 
     bool Init(const char* vertexShaderPath, const char* fragmentShaderPath, const glm::mat4& projection);
-    void drawQuad(const glm::vec2& position, const glm::vec2& size, std::shared_ptr<Texture> texture);
+    // Renders on the CPU into a width x height color buffer, textures must be loaded with Texture::s_bCpuOnly
+    bool InitSoftware(int width, int height, const glm::mat4& projection);
+
+    // Rebuilds the shaders when their .glsl files change, picked up at the start of a frame
+    void enableShaderHotReload();
+
+    void beginFrame(const glm::vec4& clearColor);
+    // Without a texture the quad is filled with the tint, the Software backend ignores the tint
+    void drawQuad(const glm::vec2& position, const glm::vec2& size, const std::shared_ptr<Texture>& texture,
+                  const glm::vec4& tint = glm::vec4(1.0f));
+    void endFrame();
+
+    // Applies to the quads drawn after the call, fragments with alpha below 0.5 are discarded
+    void setAlphaTest(bool bEnabled) { m_bAlphaTest = bEnabled; }
+    // Applies to the quads drawn after the call, lit by the ambient light and one point light
+    void setLightingEnabled(bool bEnabled) { m_bLighting = bEnabled; }
+    void setLight(const glm::vec2& position, const glm::vec3& color, float radius, const glm::vec3& ambient);
+
+    ERenderBackend getBackend() const { return m_backend; }
+    // Valid only for the Software backend, holds the last rendered frame
+    SoftwareRasterizer* getSoftwareRasterizer() const { return m_rasterizer.get(); }
+    bool usesMultiDrawIndirect() const { return m_bMultiDraw; }
 
 private:
+    static constexpr uint32_t s_maxQuads = 10000;
+    static constexpr uint32_t s_maxTextureSlots = 16;
+
+    struct QuadVertex
+    {
+        glm::vec2 position;
+        glm::vec2 texCoord;
+        uint32_t color; // RGBA8, normalized by the vertex attribute
+    };
+
+    // Consecutive quads sharing a texture and a shader variant
+    struct Batch
+    {
+        unsigned int texture; // 0 for untextured quads
+        uint32_t variant;
+        uint32_t firstQuad;
+        uint32_t quadsCount;
+    };
+
+    // Layout defined by the GL spec for the indirect buffer
+    struct DrawElementsIndirectCommand
+    {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    // Batches drawn by one glMultiDrawElementsIndirect, each texture gets its own unit
+    struct TextureGroup
+    {
+        unsigned int textures[s_maxTextureSlots];
+        uint32_t texturesCount;
+        uint32_t variant;
+        uint32_t firstCommand;
+        uint32_t commandsCount;
+    };
+
     void initRenderData();
+    // Binds the program of a variant and sets its uniforms if it is new or was replaced
+    Shader& useVariant(uint32_t variant);
+    void applyShaderUniforms(Shader& shader, uint32_t variant);
+    void flush();
+    void drawBatches();
+    void drawBatchesIndirect();
 
-    unsigned int VAO, VBO, EBO;
-    Shader m_shader;
-};
+    ERenderBackend m_backend = ERenderBackend::OpenGL;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+    // the multi draw shaders when m_bMultiDraw, otherwise the regular ones
+    ShaderVariantCache m_shaders;
+    // variants whose uniforms are up to date, bit per variant
+    uint32_t m_uniformsApplied = 0;
+    glm::mat4 m_projection = glm::mat4(1.0f);
+    // size of the viewport at beginFrame(), turns quad sizes into on-screen pixels for mip streaming
+    glm::vec2 m_viewportSize = glm::vec2(0.0f);
+    std::unique_ptr<SoftwareRasterizer> m_rasterizer;
+    std::unique_ptr<FileWatcher> m_shaderWatcher;
+
+    std::vector<QuadVertex> m_vertices;
+    std::vector<Batch> m_batches;
 
+    bool m_bAlphaTest = false;
+    bool m_bLighting = false;
+    glm::vec2 m_lightPosition = glm::vec2(0.0f);
+    glm::vec3 m_lightColor = glm::vec3(1.0f);
+    float m_lightRadius = 1.0f;
+    glm::vec3 m_ambientLight = glm::vec3(1.0f);
+
+    bool m_bMultiDraw = false;
+    uint32_t m_textureSlots = s_maxTextureSlots;
+    // instanced attribute holding 0..s_maxTextureSlots-1, baseInstance picks the texture slot of a draw
+    unsigned int m_slotBuffer = 0;
+    unsigned int m_indirectBuffer = 0;
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::vector<TextureGroup> m_groups;
+};
@@ -0,0 +1,97 @@
+#include "shader_variant_cache.h"
+
+#include <debug_logger_component.h>
+
+ShaderVariantCache::ShaderVariantCache(const std::string& vertexPath, const std::string& fragmentPath)
+    : m_vertexPath(vertexPath), m_fragmentPath(fragmentPath)
+{
+}
+
+Shader& ShaderVariantCache::get(uint32_t variant)
+{
+    std::optional<Shader>& shader = m_variants[variant];
+    if (!shader)
+    {
+        startBuild(variant, Shader::readSources(m_vertexPath, m_fragmentPath, Variant_Defines(variant)));
+    }
+    shader->waitForBuild();
+    return *shader;
+}
+
+void ShaderVariantCache::startBuild(uint32_t variant, const ShaderSources& sources)
+{
+    Debug_Log(ELogCategory::Core, "Compiling shader variant ", variant, " of ", m_vertexPath);
+    std::optional<Shader>& shader = m_variants[variant];
+    shader.emplace(sources);
+    if (m_watcher)
+    {
+        shader->watchSources(*m_watcher);
+    }
+}
+
+bool ShaderVariantCache::has(uint32_t variant) const
+{
+    return m_variants[variant].has_value();
+}
+
+void ShaderVariantCache::precompile(std::initializer_list<uint32_t> variants)
+{
+    ShaderSources base = Shader::readSources(m_vertexPath, m_fragmentPath);
+    for (uint32_t variant : variants)
+    {
+        if (m_variants[variant])
+        {
+            continue;
+        }
+        startBuild(variant, Shader::withDefines(base, Variant_Defines(variant)));
+    }
+}
+
+bool ShaderVariantCache::pollBuilds()
+{
+    bool bDone = true;
+    for (std::optional<Shader>& shader : m_variants)
+    {
+        // keep polling the others, completing a build frees its shader objects
+        if (shader && !shader->pollBuild())
+        {
+            bDone = false;
+        }
+    }
+    return bDone;
+}
+
+void ShaderVariantCache::watchSources(FileWatcher& watcher)
+{
+    m_watcher = &watcher;
+    for (std::optional<Shader>& shader : m_variants)
+    {
+        if (shader)
+        {
+            shader->watchSources(watcher);
+        }
+    }
+}
+
+uint32_t ShaderVariantCache::pollHotReload()
+{
+    uint32_t reloaded = 0;
+    for (uint32_t variant = 0; variant < SHADER_VARIANT_COUNT; ++variant)
+    {
+        if (m_variants[variant] && m_variants[variant]->pollHotReload())
+        {
+            reloaded |= 1u << variant;
+        }
+    }
+    return reloaded;
+}
+
+std::string ShaderVariantCache::Variant_Defines(uint32_t variant)
+{
+    std::string defines;
+    if (variant & SHADER_VARIANT_TEXTURED)   { defines += "#define CHERRY_TEXTURED\n"; }
+    if (variant & SHADER_VARIANT_TINTED)     { defines += "#define CHERRY_TINTED\n"; }
+    if (variant & SHADER_VARIANT_ALPHA_TEST) { defines += "#define CHERRY_ALPHA_TEST\n"; }
+    if (variant & SHADER_VARIANT_LIT)        { defines += "#define CHERRY_LIT\n"; }
+    return defines;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "basic_shader.h"
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+
+class FileWatcher;
+
+/* Features a shader variant is compiled with, combine them with | into a variant bitmask */
+enum EShaderVariant : uint32_t
+{
+    SHADER_VARIANT_TEXTURED     = 1 << 0, /* samples the texture, untextured quads use the tint only */
+    SHADER_VARIANT_TINTED       = 1 << 1, /* multiplies by the vertex color */
+    SHADER_VARIANT_ALPHA_TEST   = 1 << 2, /* discards fragments with alpha below 0.5 */
+    SHADER_VARIANT_LIT          = 1 << 3, /* ambient light plus one point light */
+    SHADER_VARIANT_COUNT        = 1 << 4  /* Should be last! Number of possible variants */
+};
+
+/*
+ * Compiles one program per variant of a vertex/fragment pair by injecting a #define per feature,
+ * so the features cost nothing in variants that do not use them(no branching on uniforms).
+ * Variants are indexed by their bitmask, get() is a plain array access once a variant exists.
+ * precompile() reads the two files once for all the variants it starts.
+ */
+class ShaderVariantCache
+{
+public:
+    ShaderVariantCache() = default;
+    ShaderVariantCache(const std::string& vertexPath, const std::string& fragmentPath);
+
+    // Compiles the variant on first use, waits for it if it is still compiling
+    Shader& get(uint32_t variant);
+    bool has(uint32_t variant) const;
+
+    // Starts compiling the variants and returns without waiting, the driver builds them concurrently
+    // (KHR_parallel_shader_compile) while the caller goes on with other work
+    void precompile(std::initializer_list<uint32_t> variants);
+    // Returns true once every started variant is done compiling, never blocks
+    bool pollBuilds();
+
+    // Hot reloads every compiled variant and the ones compiled later, the watcher must outlive the cache
+    void watchSources(FileWatcher& watcher);
+    // Returns the bitmask of the variants whose program was replaced this call
+    uint32_t pollHotReload();
+
+    // "#define CHERRY_TEXTURED\n"... for every feature of the variant
+    static std::string Variant_Defines(uint32_t variant);
+
+private:
+    // Starts the build of a variant that does not exist yet
+    void startBuild(uint32_t variant, const ShaderSources& sources);
+
+    std::string m_vertexPath;
+    std::string m_fragmentPath;
+    std::array<std::optional<Shader>, SHADER_VARIANT_COUNT> m_variants;
+    FileWatcher* m_watcher = nullptr;
+};
@@ -0,0 +1,225 @@
+#include "software_rasterizer.h"
+#include "basic_texture.h"
+
+#include <thread_pool.h>
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Packs a normalized color into the RGBA8 byte order used by the color buffer and the textures
+static uint32_t Pack_Color(const glm::vec4& color)
+{
+    auto to_byte = [](float c) { return static_cast<uint32_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f); };
+    return to_byte(color.x) | (to_byte(color.y) << 8) | (to_byte(color.z) << 16) | (to_byte(color.w) << 24);
+}
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, const glm::mat4& projection)
+    : m_width(width), m_height(height), m_projection(projection)
+{
+    m_tilesX = (m_width + s_tileSize - 1) / s_tileSize;
+    m_tilesY = (m_height + s_tileSize - 1) / s_tileSize;
+    m_color.resize(static_cast<size_t>(m_width) * m_height, 0);
+    m_bins.resize(static_cast<size_t>(m_tilesX) * m_tilesY);
+    m_pool = std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+void SoftwareRasterizer::clear(const glm::vec4& color)
+{
+    std::fill(m_color.begin(), m_color.end(), Pack_Color(color));
+}
+
+void SoftwareRasterizer::submitQuad(const glm::vec2& position, const glm::vec2& size, const std::shared_ptr<Texture>& texture)
+{
+    if(!texture || texture->pixels.empty())
+    {
+        return;
+    }
+
+    // Same transform as the vertex shader: projection * model * vertex, the quad spans [-0.5, 0.5]
+    glm::vec4 bottomLeft = m_projection * glm::vec4(position.x - size.x * 0.5f, position.y - size.y * 0.5f, 0.0f, 1.0f);
+    glm::vec4 topRight = m_projection * glm::vec4(position.x + size.x * 0.5f, position.y + size.y * 0.5f, 0.0f, 1.0f);
+
+    // NDC to window coordinates, (0, 0) is the bottom left corner like in OpenGL
+    float x0 = (bottomLeft.x / bottomLeft.w * 0.5f + 0.5f) * m_width;
+    float y0 = (bottomLeft.y / bottomLeft.w * 0.5f + 0.5f) * m_height;
+    float x1 = (topRight.x / topRight.w * 0.5f + 0.5f) * m_width;
+    float y1 = (topRight.y / topRight.w * 0.5f + 0.5f) * m_height;
+    if(x0 == x1 || y0 == y1)
+    {
+        return;
+    }
+
+    Sprite sprite;
+    // a pixel is covered when its center is inside the quad(OpenGL rasterization rule)
+    sprite.minX = std::max(0, static_cast<int>(std::ceil(std::min(x0, x1) - 0.5f)));
+    sprite.maxX = std::min(m_width, static_cast<int>(std::ceil(std::max(x0, x1) - 0.5f)));
+    sprite.minY = std::max(0, static_cast<int>(std::ceil(std::min(y0, y1) - 0.5f)));
+    sprite.maxY = std::min(m_height, static_cast<int>(std::ceil(std::max(y0, y1) - 0.5f)));
+    if(sprite.minX >= sprite.maxX || sprite.minY >= sprite.maxY)
+    {
+        return;
+    }
+    // a mirroring projection gives a negative step
+    sprite.du = 1.0f / (x1 - x0);
+    sprite.dv = 1.0f / (y1 - y0);
+    sprite.u0 = (sprite.minX + 0.5f - x0) * sprite.du;
+    sprite.v0 = (sprite.minY + 0.5f - y0) * sprite.dv;
+    sprite.texture = texture;
+    m_sprites.push_back(std::move(sprite));
+}
+
+void SoftwareRasterizer::flush()
+{
+    if(m_sprites.empty())
+    {
+        return;
+    }
+
+    // Binning is cheap compared to rasterization so it stays on the calling thread
+    for(auto& bin : m_bins)
+    {
+        bin.clear();
+    }
+    for(uint32_t i = 0; i < m_sprites.size(); ++i)
+    {
+        const Sprite& sprite = m_sprites[i];
+        for(int ty = sprite.minY / s_tileSize; ty <= (sprite.maxY - 1) / s_tileSize; ++ty)
+        {
+            for(int tx = sprite.minX / s_tileSize; tx <= (sprite.maxX - 1) / s_tileSize; ++tx)
+            {
+                m_bins[ty * m_tilesX + tx].push_back(i);
+            }
+        }
+    }
+
+    // One task per worker, each worker grabs the next tile until none are left
+    std::atomic<int> nextTile{0};
+    const int tilesCount = m_tilesX * m_tilesY;
+    std::vector<std::future<void>> futures;
+    for(uint32_t i = 0; i < m_pool->Get_Number_Of_Threads(); ++i)
+    {
+        futures.push_back(m_pool->Add_Task([this, &nextTile, tilesCount]()
+        {
+            for(int tile = nextTile++; tile < tilesCount; tile = nextTile++)
+            {
+                rasterizeTile(tile);
+            }
+        }));
+    }
+    for(auto& future : futures)
+    {
+        future.get();
+    }
+    m_sprites.clear();
+}
+
+void SoftwareRasterizer::rasterizeTile(int tileIndex)
+{
+    const std::vector<uint32_t>& bin = m_bins[tileIndex];
+    const int tileMinX = (tileIndex % m_tilesX) * s_tileSize;
+    const int tileMinY = (tileIndex / m_tilesX) * s_tileSize;
+    const int tileMaxX = std::min(tileMinX + s_tileSize, m_width);
+    const int tileMaxY = std::min(tileMinY + s_tileSize, m_height);
+
+    // texel column of every pixel in the tile, the same for all rows of a sprite
+    alignas(16) int columns[s_tileSize];
+
+    for(uint32_t spriteIndex : bin)
+    {
+        const Sprite& sprite = m_sprites[spriteIndex];
+        const Texture& texture = *sprite.texture;
+        const int minX = std::max(sprite.minX, tileMinX);
+        const int maxX = std::min(sprite.maxX, tileMaxX);
+        const int minY = std::max(sprite.minY, tileMinY);
+        const int maxY = std::min(sprite.maxY, tileMaxY);
+        const int count = maxX - minX;
+        const float texWidth = static_cast<float>(texture.width);
+        const float uStart = sprite.u0 + (minX - sprite.minX) * sprite.du;
+
+        // Nearest texel lookup, u is clamped to the texture so edge pixels never read out of bounds
+        int x = 0;
+#if defined(__SSE2__)
+        const __m128 scale = _mm_set1_ps(texWidth);
+        const __m128 maxColumn = _mm_set1_ps(texWidth - 1.0f);
+        const __m128 step = _mm_set1_ps(sprite.du * 4.0f);
+        __m128 u = _mm_add_ps(_mm_set1_ps(uStart), _mm_mul_ps(_mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f), _mm_set1_ps(sprite.du)));
+        for(; x + 4 <= count; x += 4)
+        {
+            __m128 column = _mm_min_ps(_mm_max_ps(_mm_mul_ps(u, scale), _mm_setzero_ps()), maxColumn);
+            _mm_store_si128(reinterpret_cast<__m128i*>(columns + x), _mm_cvttps_epi32(column));
+            u = _mm_add_ps(u, step);
+        }
+#endif
+        for(; x < count; ++x)
+        {
+            float column = std::clamp((uStart + x * sprite.du) * texWidth, 0.0f, texWidth - 1.0f);
+            columns[x] = static_cast<int>(column);
+        }
+        // unscaled sprites map to a contiguous texel run and can be copied row by row
+        const bool bContiguous = columns[count - 1] - columns[0] == count - 1;
+
+        for(int y = minY; y < maxY; ++y)
+        {
+            float v = sprite.v0 + (y - sprite.minY) * sprite.dv;
+            int row = std::clamp(static_cast<int>(v * texture.height), 0, texture.height - 1);
+            const uint32_t* src = texture.pixels.data() + static_cast<size_t>(row) * texture.width;
+            uint32_t* dst = m_color.data() + static_cast<size_t>(y) * m_width + minX;
+
+            // Blending is disabled in the OpenGL backend as well, texels overwrite the destination
+            if(bContiguous)
+            {
+                std::memcpy(dst, src + columns[0], count * sizeof(uint32_t));
+                continue;
+            }
+            int i = 0;
+#if defined(__SSE2__)
+            for(; i + 4 <= count; i += 4)
+            {
+                __m128i texels = _mm_set_epi32(src[columns[i + 3]], src[columns[i + 2]], src[columns[i + 1]], src[columns[i]]);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), texels);
+            }
+#endif
+            for(; i < count; ++i)
+            {
+                dst[i] = src[columns[i]];
+            }
+        }
+    }
+}
+
+bool SoftwareRasterizer::saveToPPM(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Could not open ", path, " for writing");
+        return false;
+    }
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+    std::vector<unsigned char> row(static_cast<size_t>(m_width) * 3);
+    // the color buffer starts with the bottom row, images start with the top one
+    for(int y = m_height - 1; y >= 0; --y)
+    {
+        const uint32_t* src = m_color.data() + static_cast<size_t>(y) * m_width;
+        for(int x = 0; x < m_width; ++x)
+        {
+            row[x * 3 + 0] = src[x] & 0xFF;
+            row[x * 3 + 1] = (src[x] >> 8) & 0xFF;
+            row[x * 3 + 2] = (src[x] >> 16) & 0xFF;
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return file.good();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ * CPU backend of the Renderer2D, used on machines without a GPU(dedicated servers, test rigs).
+ * Submitted quads are binned into fixed size screen tiles and the tiles are rasterized
+ * in parallel on the ThreadPool. Two tiles never share a pixel so the workers need no locking.
+ * The output is an RGBA8 color buffer stored bottom row first, the same layout glReadPixels returns.
+ */
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Texture;
+class ThreadPool;
+
+class SoftwareRasterizer
+{
+public:
+    SoftwareRasterizer(int width, int height, const glm::mat4& projection);
+    ~SoftwareRasterizer();
+
+    // Fills the color buffer, the software equivalent of glClear
+    void clear(const glm::vec4& color);
+
+    // Queues a quad, nothing is rasterized before flush()
+    void submitQuad(const glm::vec2& position, const glm::vec2& size, const std::shared_ptr<Texture>& texture);
+
+    // Bins the queued quads into tiles and rasterizes the tiles on the thread pool
+    void flush();
+
+    const std::vector<uint32_t>& getColorBuffer() const { return m_color; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    // Writes the color buffer as a binary PPM(thumbnails, regression images)
+    bool saveToPPM(const std::string& path) const;
+
+private:
+    // A quad already transformed to screen space
+    struct Sprite
+    {
+        // pixel rect covered by the quad, max is exclusive
+        int minX, minY, maxX, maxY;
+        // texture coordinate at the center of pixel minX/minY and its step per pixel
+        float u0, v0, du, dv;
+        std::shared_ptr<Texture> texture;
+    };
+
+    void rasterizeTile(int tileIndex);
+
+    static constexpr int s_tileSize = 64;
+
+    int m_width;
+    int m_height;
+    int m_tilesX;
+    int m_tilesY;
+    glm::mat4 m_projection;
+
+    std::vector<uint32_t> m_color;
+    std::vector<Sprite> m_sprites;
+    // sprite indices per tile in submission order, so overlapping sprites keep their draw order
+    std::vector<std::vector<uint32_t>> m_bins;
+    std::unique_ptr<ThreadPool> m_pool;
+};
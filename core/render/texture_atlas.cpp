@@ -0,0 +1,169 @@
+#include "texture_atlas.h"
+
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+SkylinePacker::SkylinePacker(int width, int height)
+    : m_width(width), m_height(height)
+{
+    m_skyline.push_back({0, 0, width});
+}
+
+int SkylinePacker::fit(size_t index, int width, int height) const
+{
+    if (m_skyline[index].x + width > m_width)
+    {
+        return -1;
+    }
+    // the rectangle rests on the highest segment below it
+    int y = 0;
+    int widthLeft = width;
+    for (size_t i = index; widthLeft > 0; ++i)
+    {
+        y = std::max(y, m_skyline[i].y);
+        if (y + height > m_height)
+        {
+            return -1;
+        }
+        widthLeft -= m_skyline[i].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::pack(int width, int height, int& x, int& y)
+{
+    size_t bestIndex = m_skyline.size();
+    int bestY = INT_MAX;
+    int bestWidth = INT_MAX;
+    for (size_t i = 0; i < m_skyline.size(); ++i)
+    {
+        int restY = fit(i, width, height);
+        if (restY == -1)
+        {
+            continue;
+        }
+        if (restY < bestY || (restY == bestY && m_skyline[i].width < bestWidth))
+        {
+            bestIndex = i;
+            bestY = restY;
+            bestWidth = m_skyline[i].width;
+        }
+    }
+    if (bestIndex == m_skyline.size())
+    {
+        return false;
+    }
+    x = m_skyline[bestIndex].x;
+    y = bestY;
+
+    // The new segment covers the rectangle, the segments under it shrink or disappear
+    m_skyline.insert(m_skyline.begin() + bestIndex, {x, y + height, width});
+    for (size_t i = bestIndex + 1; i < m_skyline.size();)
+    {
+        const int covered = (x + width) - m_skyline[i].x;
+        if (covered <= 0)
+        {
+            break;
+        }
+        if (covered < m_skyline[i].width)
+        {
+            m_skyline[i].x += covered;
+            m_skyline[i].width -= covered;
+            break;
+        }
+        m_skyline.erase(m_skyline.begin() + i);
+    }
+    // Neighbours at the same height are one segment
+    for (size_t i = 0; i + 1 < m_skyline.size();)
+    {
+        if (m_skyline[i].y == m_skyline[i + 1].y)
+        {
+            m_skyline[i].width += m_skyline[i + 1].width;
+            m_skyline.erase(m_skyline.begin() + i + 1);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return true;
+}
+
+bool TextureAtlas::add(const std::string& name, const DecodedImage& image)
+{
+    if (!image.data || image.width > s_maxImageSize || image.height > s_maxImageSize)
+    {
+        return false;
+    }
+    const int paddedWidth = image.width + s_padding * 2;
+    const int paddedHeight = image.height + s_padding * 2;
+
+    int x = 0;
+    int y = 0;
+    uint32_t page = 0;
+    while (page < m_pages.size() && !m_pages[page].packer.pack(paddedWidth, paddedHeight, x, y))
+    {
+        ++page;
+    }
+    if (page == m_pages.size())
+    {
+        m_pages.emplace_back();
+        m_pages.back().packer.pack(paddedWidth, paddedHeight, x, y);
+    }
+
+    blit(m_pages[page], image, x, y);
+    m_entries.push_back({name, page, x + s_padding, y + s_padding, image.width, image.height});
+    return true;
+}
+
+void TextureAtlas::blit(Page& page, const DecodedImage& image, int x, int y)
+{
+    const unsigned char* source = image.data.get();
+    const int channels = image.nrChannels;
+    // Rows outside the image repeat its first/last row, columns its first/last column
+    for (int row = 0; row < image.height + s_padding * 2; ++row)
+    {
+        const int sourceRow = std::clamp(row - s_padding, 0, image.height - 1);
+        const unsigned char* sourceLine = source + static_cast<size_t>(sourceRow) * image.width * channels;
+        uint32_t* destination = page.pixels.data() + static_cast<size_t>(y + row) * s_pageSize + x;
+        for (int column = 0; column < image.width + s_padding * 2; ++column)
+        {
+            const unsigned char* texel = sourceLine + static_cast<size_t>(std::clamp(column - s_padding, 0, image.width - 1)) * channels;
+            uint32_t rgba = 0;
+            switch (channels)
+            {
+                case 4: std::memcpy(&rgba, texel, 4); break;
+                case 3: rgba = texel[0] | (texel[1] << 8) | (texel[2] << 16) | 0xFF000000u; break;
+                case 2: rgba = texel[0] * 0x010101u | (static_cast<uint32_t>(texel[1]) << 24); break;
+                default: rgba = texel[0] * 0x010101u | 0xFF000000u; break;
+            }
+            destination[column] = rgba;
+        }
+    }
+}
+
+std::vector<std::pair<std::string, std::shared_ptr<Texture>>> TextureAtlas::build()
+{
+    static_assert((1 << s_maxLevel) <= s_padding, "the coarsest level of a page must keep a texel of padding");
+    std::vector<std::shared_ptr<Texture>> pages;
+    for (size_t i = 0; i < m_pages.size(); ++i)
+    {
+        pages.push_back(std::make_shared<Texture>("atlas_page_" + std::to_string(i), s_pageSize, s_pageSize, m_pages[i].pixels.data(), s_maxLevel));
+    }
+
+    std::vector<std::pair<std::string, std::shared_ptr<Texture>>> textures;
+    for (const Entry& entry : m_entries)
+    {
+        const glm::vec2 uvMin(static_cast<float>(entry.x) / s_pageSize, static_cast<float>(entry.y) / s_pageSize);
+        const glm::vec2 uvMax(static_cast<float>(entry.x + entry.width) / s_pageSize, static_cast<float>(entry.y + entry.height) / s_pageSize);
+        textures.emplace_back(entry.name, std::make_shared<Texture>(entry.name, pages[entry.page], uvMin, uvMax, entry.width, entry.height));
+    }
+    Debug_Log(ELogCategory::Core, "Packed ", m_entries.size(), " textures into ", m_pages.size(), " atlas pages");
+
+    m_pages.clear();
+    m_entries.clear();
+    return textures;
+}
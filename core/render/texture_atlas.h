@@ -0,0 +1,97 @@
+#pragma once
+
+/*
+ * Packs many small images into a few large atlas pages.
+ * Every packed image becomes a sub texture: a Texture sharing the GL texture of its page
+ * with the UV rect of its area. Quads drawn with sub textures of the same page share one bind
+ * and end up in the same batch.
+ *
+ * Each image is surrounded by s_padding pixels repeating its edge so linear filtering
+ * never blends in a neighbour. A mip level halves the padding, the pages therefore only get the levels
+ * that keep at least one texel of it(s_maxLevel), coarser ones would blend neighbours into each other.
+ *
+ * Example usage:
+ * @code
+ * TextureAtlas atlas;
+ * if (!atlas.add("coin.png", image)) { ... load it on its own ... }
+ * for (auto& [name, texture] : atlas.build()) { ... }
+ * @endcode
+ */
+
+#include "basic_texture.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Skyline bottom left packer. The skyline is the top edge of everything placed so far,
+ * a rectangle goes where it ends up lowest, ties go to the narrower segment to waste less space.
+ */
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+
+    // Finds room for a width x height rectangle, false if the page is too full
+    bool pack(int width, int height, int& x, int& y);
+
+private:
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    // y the rectangle would rest at when its left edge is at segment index, -1 if it does not fit
+    int fit(size_t index, int width, int height) const;
+
+    int m_width;
+    int m_height;
+    std::vector<Segment> m_skyline;
+};
+
+class TextureAtlas
+{
+public:
+    static constexpr int s_pageSize = 2048;
+    static constexpr int s_padding = 2;
+    // log2(s_padding)
+    static constexpr int s_maxLevel = 1;
+    // Larger images are not worth atlasing, they would only fragment the pages
+    static constexpr int s_maxImageSize = 256;
+
+    // Copies the image into a page, false if it is too large to be atlased
+    bool add(const std::string& name, const DecodedImage& image);
+
+    // GL thread. Uploads the pages and returns a sub texture for every added image
+    std::vector<std::pair<std::string, std::shared_ptr<Texture>>> build();
+
+    size_t getPagesCount() const { return m_pages.size(); }
+
+private:
+    struct Page
+    {
+        SkylinePacker packer{s_pageSize, s_pageSize};
+        std::vector<uint32_t> pixels = std::vector<uint32_t>(static_cast<size_t>(s_pageSize) * s_pageSize, 0);
+    };
+
+    struct Entry
+    {
+        std::string name;
+        uint32_t page;
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
+    // Copies the image with its extruded border, (x, y) is the corner of the padded area
+    void blit(Page& page, const DecodedImage& image, int x, int y);
+
+    std::vector<Page> m_pages;
+    std::vector<Entry> m_entries;
+};
@@ -0,0 +1,176 @@
+#include "texture_budget.h"
+#include "texture_streamer.h"
+
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <cmath>
+
+TextureBudget::TextureBudget(size_t budgetBytes)
+    : m_budget(budgetBytes)
+{
+}
+
+void TextureBudget::track(const std::shared_ptr<Texture>& texture)
+{
+    // sub textures own no memory, evicting one would not free anything
+    if (texture && !texture->isSubTexture())
+    {
+        m_entries.push_back({texture, false, 0, -1, 0});
+    }
+}
+
+void TextureBudget::update(TextureStreamer& streamer)
+{
+    const uint64_t frame = Texture::s_currentFrame;
+    m_residentBytes = 0;
+    m_evictedCount = 0;
+    m_evictedByLastUpdate = 0;
+    // entries of resident textures not used in this or the previous frame and not being restreamed
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < m_entries.size();)
+    {
+        Entry& entry = m_entries[i];
+        std::shared_ptr<Texture> texture = entry.texture.lock();
+        if (!texture)
+        {
+            entry = m_entries.back();
+            m_entries.pop_back();
+            continue;
+        }
+        if (entry.bEvicted)
+        {
+            // used again since the eviction, it shows the placeholder until the streamer is done
+            if (texture->getLastUsedFrame() >= entry.evictedFrame)
+            {
+                entry.requestedBase = Texture::s_bCpuOnly ? 0 : Wanted_Base_Level(texture->getScreenScale(), texture->getLevelsCount());
+                streamer.request(texture, entry.requestedBase);
+                entry.bEvicted = false;
+                entry.coarserSince = 0;
+            }
+            else
+            {
+                ++m_evictedCount;
+            }
+            ++i;
+            continue;
+        }
+        // The streamer dropped the request(the file failed to decode), the requested level never arrives
+        if (entry.requestedBase != -1 && !streamer.isPending(*texture) && (!texture->isResident() || texture->getBaseLevel() != entry.requestedBase))
+        {
+            if (!entry.bStreamFailed)
+            {
+                Debug_Log(ELogCategory::Core, EPrintColor::Yellow, "TextureBudget: streaming ", texture->filePath, " failed, retrying in ",
+                          s_retryDelayFrames, " frames");
+                entry.bStreamFailed = true;
+            }
+            entry.retryFrame = frame + s_retryDelayFrames;
+            if (!texture->isResident())
+            {
+                // the reload after an eviction, reloaded again when used after the delay
+                entry.requestedBase = -1;
+                entry.bEvicted = true;
+                entry.evictedFrame = entry.retryFrame;
+                ++m_evictedCount;
+                ++i;
+                continue;
+            }
+            // keeps the levels it has, evictable again
+            entry.requestedBase = texture->getBaseLevel();
+        }
+        // not resident yet while streaming
+        if (texture->isResident())
+        {
+            if (!Texture::s_bCpuOnly)
+            {
+                streamMips(entry, texture, streamer);
+            }
+            m_residentBytes += texture->getByteSize();
+            if (texture->getLastUsedFrame() + 1 < frame && entry.requestedBase == -1)
+            {
+                candidates.push_back(i);
+            }
+        }
+        ++i;
+    }
+
+    if (m_residentBytes <= m_budget)
+    {
+        m_bOverBudget = false;
+        return;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b)
+    {
+        return m_entries[a].texture.lock()->getLastUsedFrame() < m_entries[b].texture.lock()->getLastUsedFrame();
+    });
+    const unsigned int placeholder = Texture::s_bCpuOnly ? 0 : streamer.getPlaceholder();
+    for (size_t i = 0; i < candidates.size() && m_residentBytes > m_budget; ++i)
+    {
+        Entry& entry = m_entries[candidates[i]];
+        std::shared_ptr<Texture> texture = entry.texture.lock();
+        m_residentBytes -= texture->getByteSize();
+        texture->evict(placeholder);
+        entry.bEvicted = true;
+        entry.evictedFrame = frame;
+        ++m_evictedCount;
+        ++m_evictedByLastUpdate;
+    }
+
+    if (m_residentBytes > m_budget && !m_bOverBudget)
+    {
+        Debug_Log(ELogCategory::Core, EPrintColor::Yellow, "TextureBudget: the textures of the last two frames need ",
+                  m_residentBytes / (1024 * 1024), " MiB, over the budget of ", m_budget / (1024 * 1024), " MiB");
+    }
+    m_bOverBudget = m_residentBytes > m_budget;
+}
+
+int TextureBudget::Wanted_Base_Level(float screenScale, int levelsCount)
+{
+    // Level L has 1/2^L of the texels, sampling goes down to it once a texel covers less than 1/2^L pixels
+    if (screenScale >= 1.0f || levelsCount <= 1)
+    {
+        return 0;
+    }
+    const int level = static_cast<int>(std::floor(std::log2(1.0f / std::max(screenScale, 1e-6f))));
+    return std::min(level, levelsCount - 1);
+}
+
+void TextureBudget::streamMips(Entry& entry, const std::shared_ptr<Texture>& texture, TextureStreamer& streamer)
+{
+    const uint64_t frame = Texture::s_currentFrame;
+    if (entry.requestedBase != -1)
+    {
+        if (texture->getBaseLevel() != entry.requestedBase)
+        {
+            return; // still streaming
+        }
+        entry.requestedBase = -1;
+    }
+    // only the last frame tells how the texture is drawn now
+    if (texture->getLastUsedFrame() + 1 != frame || texture->getLevelsCount() <= 1 || frame < entry.retryFrame)
+    {
+        return;
+    }
+
+    const int wanted = Wanted_Base_Level(texture->getScreenScale(), texture->getLevelsCount());
+    if (wanted == texture->getBaseLevel())
+    {
+        entry.coarserSince = 0;
+        return;
+    }
+    if (wanted > texture->getBaseLevel())
+    {
+        if (entry.coarserSince == 0)
+        {
+            entry.coarserSince = frame;
+        }
+        if (frame - entry.coarserSince < s_dropDelayFrames)
+        {
+            return;
+        }
+    }
+    streamer.request(texture, wanted);
+    entry.requestedBase = wanted;
+    entry.coarserSince = 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+/*
+ * Keeps the memory of the tracked textures under a budget.
+ * Every texture is stamped with the frame it was last used in(Texture::markUsed, called when it is
+ * bound or drawn). When the resident textures add up to more than the budget, the least recently used
+ * ones are evicted: their memory is freed and they show the streamer's placeholder. An evicted texture
+ * that gets used again is streamed back in, the shared_ptr handed out before stays valid throughout.
+ *
+ * Textures used in the current or the previous frame are never evicted, a frame that needs more
+ * than the budget goes over it rather than thrashing.
+ *
+ * Within a resident texture only the mip levels it is drawn at stay in memory. From the largest
+ * on-screen size of the last frame(Texture::getScreenScale) follows the finest level sampling can
+ * reach, the texture is restreamed with that level as GL_TEXTURE_BASE_LEVEL. Finer levels are
+ * streamed in right away, dropping levels waits s_dropDelayFrames so zooming back and forth
+ * does not restream all the time.
+ *
+ * Example usage:
+ * @code
+ * TextureBudget budget(256 * 1024 * 1024);
+ * budget.track(texture);
+ * // every frame on the GL thread, after ++Texture::s_currentFrame
+ * budget.update(streamer);
+ * @endcode
+ */
+
+#include "basic_texture.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class TextureStreamer;
+
+class TextureBudget
+{
+public:
+    explicit TextureBudget(size_t budgetBytes);
+
+    void setBudget(size_t budgetBytes) { m_budget = budgetBytes; }
+    size_t getBudget() const { return m_budget; }
+
+    // The budget does not keep textures alive, released ones are dropped. Atlas sub textures are ignored.
+    void track(const std::shared_ptr<Texture>& texture);
+
+    // GL thread, once per frame. Reloads evicted textures used since their eviction
+    // and evicts the least recently used ones while over the budget.
+    void update(TextureStreamer& streamer);
+
+    // Finest mip level a texture drawn at screenScale on-screen pixels per texel samples
+    static int Wanted_Base_Level(float screenScale, int levelsCount);
+
+    // As of the last update()
+    size_t getResidentBytes() const { return m_residentBytes; }
+    // textures still evicted
+    size_t getEvictedCount() const { return m_evictedCount; }
+    // textures the last update() evicted itself, the budget was under pressure in that frame
+    size_t getEvictedByLastUpdate() const { return m_evictedByLastUpdate; }
+
+private:
+    static constexpr uint64_t s_dropDelayFrames = 120;
+    // frames before a texture the streamer failed to load is requested again
+    static constexpr uint64_t s_retryDelayFrames = 120;
+
+    struct Entry
+    {
+        std::weak_ptr<Texture> texture;
+        bool bEvicted{false};
+        uint64_t evictedFrame{0};
+        // base level being streamed in, -1 when none
+        int requestedBase{-1};
+        // first frame of the current stretch in which coarser levels would do, 0 when there is none
+        uint64_t coarserSince{0};
+        // a failed request is not repeated before this frame
+        uint64_t retryFrame{0};
+        // the failure is only logged the first time
+        bool bStreamFailed{false};
+    };
+
+    // Restreams the texture when the levels in memory do not match how it was drawn in the last frame
+    void streamMips(Entry& entry, const std::shared_ptr<Texture>& texture, TextureStreamer& streamer);
+
+    std::vector<Entry> m_entries;
+    size_t m_budget;
+    size_t m_residentBytes = 0;
+    size_t m_evictedCount = 0;
+    size_t m_evictedByLastUpdate = 0;
+    // only warn once per stretch of frames spent over the budget
+    bool m_bOverBudget = false;
+};
@@ -0,0 +1,188 @@
+#include "texture_streamer.h"
+#include "cooked_texture.h"
+
+#include <thread_pool.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+TextureStreamer::TextureStreamer()
+{
+    m_pool = std::make_unique<ThreadPool>(std::thread::hardware_concurrency());
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    // joins the workers before the futures they fill and the slots they copy into are destroyed
+    m_pool.reset();
+    if (m_placeholder != 0)
+    {
+        glDeleteTextures(1, &m_placeholder);
+    }
+}
+
+std::shared_ptr<Texture> TextureStreamer::request(const std::string& path)
+{
+    std::shared_ptr<Texture> texture = std::make_shared<Texture>(path, Texture::s_bCpuOnly ? 0 : getPlaceholder());
+    request(texture);
+    return texture;
+}
+
+void TextureStreamer::request(const std::shared_ptr<Texture>& texture, int baseLevel)
+{
+    // Nothing to decode, the stored levels are uploaded as they are(same as loading a cooked texture)
+    if (texture->isCooked() && m_cookedSource)
+    {
+        CookedTexture cooked;
+        if (m_cookedSource(texture->filePath, cooked) && Texture::supportsCookedFormat(cooked.getFormat()))
+        {
+            texture->upload(cooked, baseLevel);
+            return;
+        }
+    }
+    PendingTexture pending;
+    pending.texture = texture;
+    pending.baseLevel = baseLevel;
+    pending.decode = m_pool->Add_Task([path = texture->filePath, decoder = m_decoder](){ return decoder ? decoder(path) : Texture::decode(path); });
+    m_pending.push_back(std::move(pending));
+}
+
+bool TextureStreamer::isPending(const Texture& texture) const
+{
+    return std::any_of(m_pending.begin(), m_pending.end(), [&texture](const PendingTexture& pending)
+    {
+        return pending.texture.lock().get() == &texture;
+    });
+}
+
+void TextureStreamer::update(float budgetMs)
+{
+    using Clock = std::chrono::high_resolution_clock;
+    const Clock::time_point start = Clock::now();
+    bool bWorked = false;
+    auto budgetLeft = [&]()
+    {
+        return !bWorked || std::chrono::duration<float, std::milli>(Clock::now() - start).count() < budgetMs;
+    };
+
+    // Requests are served in order, a texture still on a worker does not hold back the ones after it
+    for (size_t i = 0; i < m_pending.size() && budgetLeft();)
+    {
+        PendingTexture& pending = m_pending[i];
+        if (pending.stage == EStreamStage::Decoding)
+        {
+            if (pending.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++i;
+                continue;
+            }
+            pending.image = pending.decode.get();
+            pending.stage = EStreamStage::Decoded;
+        }
+
+        if (pending.stage == EStreamStage::Decoded)
+        {
+            std::shared_ptr<Texture> texture = pending.texture.lock();
+            // a failed decode keeps the placeholder, the error was logged by decode()
+            if (!texture || !pending.image.data)
+            {
+                m_pending.erase(m_pending.begin() + i);
+                continue;
+            }
+            if (Texture::s_bCpuOnly)
+            {
+                texture->upload(pending.image); // no GL, just a copy into RAM
+                m_pending.erase(m_pending.begin() + i);
+                continue;
+            }
+            if (!startCopy(pending))
+            {
+                ++i; // every slot is in flight, try again next frame
+                continue;
+            }
+            bWorked = true;
+            ++i;
+            continue;
+        }
+
+        // EStreamStage::Copying
+        if (pending.copy.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++i;
+            continue;
+        }
+        if (std::shared_ptr<Texture> texture = pending.texture.lock())
+        {
+            texture->upload(*m_ring, pending.slot, pending.image, pending.baseLevel);
+        }
+        else
+        {
+            // released while copying, hand the slot back
+            m_ring->bindForUpload(pending.slot);
+            m_ring->finishUpload(pending.slot);
+        }
+        bWorked = true;
+        m_pending.erase(m_pending.begin() + i);
+    }
+}
+
+bool TextureStreamer::startCopy(PendingTexture& pending)
+{
+    if (!m_ring)
+    {
+        m_ring = std::make_unique<PixelUploadRing>();
+    }
+    // The levels from baseLevel on back to back. The image stays in pending until the upload, the worker only
+    // borrows its pixels(pending itself moves around m_pending, the pixel buffers do not).
+    const DecodedImage& image = pending.image;
+    pending.baseLevel = std::clamp(pending.baseLevel, 0, static_cast<int>(image.mips.size()));
+    std::vector<std::pair<const void*, size_t>> levels;
+    size_t size = 0;
+    if (pending.baseLevel == 0)
+    {
+        levels.emplace_back(image.data.get(), static_cast<size_t>(image.width) * image.height * image.nrChannels);
+        size += levels.back().second;
+    }
+    for (size_t level = std::max(pending.baseLevel, 1); level <= image.mips.size(); ++level)
+    {
+        const MipLevel& mip = image.mips[level - 1];
+        levels.emplace_back(mip.pixels.data(), mip.pixels.size());
+        size += mip.pixels.size();
+    }
+    int slot = m_ring->map(size);
+    if (slot == -1)
+    {
+        return false;
+    }
+    pending.slot = slot;
+    pending.stage = EStreamStage::Copying;
+    pending.copy = m_pool->Add_Task([destination = static_cast<uint8_t*>(m_ring->getMapped(slot)), levels = std::move(levels)]()
+    {
+        size_t offset = 0;
+        for (const auto& [pixels, levelSize] : levels)
+        {
+            std::memcpy(destination + offset, pixels, levelSize);
+            offset += levelSize;
+        }
+    });
+    return true;
+}
+
+unsigned int TextureStreamer::getPlaceholder()
+{
+    if (m_placeholder != 0)
+    {
+        return m_placeholder;
+    }
+    // Magenta and black, hard to mistake for a real texture
+    const uint32_t pixels[4] = {0xFFFF00FF, 0xFF000000, 0xFF000000, 0xFFFF00FF};
+    glGenTextures(1, &m_placeholder);
+    glBindTexture(GL_TEXTURE_2D, m_placeholder);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 2, 2, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    return m_placeholder;
+}
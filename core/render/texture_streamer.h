@@ -0,0 +1,102 @@
+#pragma once
+
+/*
+ * Loads textures without stalling the frame.
+ * request() returns right away with a texture showing a placeholder. The file is decoded on the
+ * ThreadPool and update(), called once per frame on the GL thread, uploads the decoded images
+ * until the frame's upload budget is spent. Whatever does not fit waits for the next frame.
+ *
+ * Uploads go through a PixelUploadRing: update() maps a slot for a decoded image, a worker copies the
+ * pixels into it and a later update() sources glTexSubImage2D from the slot, so the GL thread never
+ * copies pixels itself and the driver transfers them asynchronously. Every upload fills a new texture object
+ * allocated right before it, the object a draw may still sample is only deleted afterwards.
+ *
+ * Example usage:
+ * @code
+ * TextureStreamer streamer;
+ * std::shared_ptr<Texture> texture = streamer.request("../assets/berserk.png");
+ * // every frame
+ * streamer.update(2.0f);
+ * renderer.drawQuad(position, size, texture); // placeholder until resident
+ * @endcode
+ */
+
+#include "basic_texture.h"
+#include "pixel_upload_ring.h"
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+class CookedTexture;
+
+class TextureStreamer
+{
+public:
+    TextureStreamer();
+    ~TextureStreamer();
+
+    // Starts decoding the file, the texture draws the placeholder until it is resident
+    std::shared_ptr<Texture> request(const std::string& path);
+    // Streams texture->filePath into an existing texture, an evicted one for example, with the mip levels from
+    // baseLevel on. A resident texture keeps drawing its current levels until the new ones are uploaded.
+    // A cooked texture is reloaded from the cooked source right away with its stored levels from baseLevel on,
+    // decoding filePath would bring a block compressed texture back as RGBA8.
+    void request(const std::shared_ptr<Texture>& texture, int baseLevel = 0);
+
+    // Decodes texture->filePath on a worker instead of Texture::decode(path), the ResourceManager reads
+    // textures out of its AssetPack with it. Applies to the requests made after the call.
+    using Decoder = std::function<DecodedImage(const std::string& path)>;
+    void setDecoder(Decoder decoder) { m_decoder = std::move(decoder); }
+
+    // Opens the cooked texture a cooked Texture with this filePath was loaded from, false if there is none any more
+    // (filePath is then decoded). Called on the GL thread by request().
+    using CookedSource = std::function<bool(const std::string& path, CookedTexture& cooked)>;
+    void setCookedSource(CookedSource source) { m_cookedSource = std::move(source); }
+
+    // Uploads decoded textures for at most budgetMs(at least one per call so loading always advances)
+    void update(float budgetMs);
+
+    // Number of requested textures not resident yet
+    size_t getPendingCount() const { return m_pending.size(); }
+    // Whether a request for the texture is still decoding or waiting for its upload, a failed one is dropped
+    bool isPending(const Texture& texture) const;
+
+    // GL thread. 2x2 checkerboard shared by every texture that is not resident, created on first use
+    unsigned int getPlaceholder();
+
+private:
+    enum class EStreamStage : unsigned char
+    {
+        Decoding, /* stb_image on a worker */
+        Decoded,  /* waiting for a free ring slot */
+        Copying   /* worker copying the pixels into a ring slot */
+    };
+
+    struct PendingTexture
+    {
+        // the streamer does not keep textures alive, a texture released while loading is dropped
+        std::weak_ptr<Texture> texture;
+        std::future<DecodedImage> decode;
+        EStreamStage stage{EStreamStage::Decoding};
+        DecodedImage image;
+        int baseLevel{0};
+        int slot{-1};
+        std::future<void> copy;
+    };
+
+    // Starts copying a decoded image into a ring slot, false if every slot is still in flight
+    bool startCopy(PendingTexture& pending);
+
+    std::unique_ptr<ThreadPool> m_pool;
+    // created with the first upload, GL only
+    std::unique_ptr<PixelUploadRing> m_ring;
+    std::vector<PendingTexture> m_pending;
+    Decoder m_decoder;
+    CookedSource m_cookedSource;
+    unsigned int m_placeholder = 0;
+};
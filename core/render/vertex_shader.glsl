@@ -1,13 +1,21 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
 
-uniform mat4 uModel;
 uniform mat4 uProjection;
 
 out vec2 TexCoord;
+out vec4 Color;
+#ifdef CHERRY_LIT
+out vec2 WorldPos;
+#endif
 
 void main() {
-    gl_Position = uProjection * uModel * vec4(aPos, 0.0, 1.0);
+    gl_Position = uProjection * vec4(aPos, 0.0, 1.0);
     TexCoord = aTexCoord;
+    Color = aColor;
+#ifdef CHERRY_LIT
+    WorldPos = aPos;
+#endif
 }
@@ -0,0 +1,188 @@
+#include "asset_pack.h"
+
+#include <debug_logger_component.h>
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define CHERRY_HAS_MMAP
+#endif
+
+// Order of the table of contents
+static bool Entry_Less(const AssetPackEntry& a, const AssetPackEntry& b)
+{
+    return a.id != b.id ? a.id < b.id : a.type < b.type;
+}
+
+AssetPack::~AssetPack()
+{
+    Close();
+}
+
+bool AssetPack::Open(const std::string& path)
+{
+    Close();
+#ifdef CHERRY_HAS_MMAP
+    int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(file == -1)
+    {
+        return false;
+    }
+    struct stat info{};
+    if(fstat(file, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(AssetPackHeader)))
+    {
+        ::close(file);
+        return false;
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file); // the mapping stays valid
+    if(mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    // Loading walks the blobs in order, let the kernel read ahead
+    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(mapped);
+    m_size = static_cast<size_t>(info.st_size);
+#else
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        return false;
+    }
+    m_buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size());
+    if(!file || m_buffer.size() < sizeof(AssetPackHeader))
+    {
+        m_buffer.clear();
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#endif
+
+    // Validate everything Find and GetData index so a broken pack can not read out of bounds
+    const AssetPackHeader& header = *reinterpret_cast<const AssetPackHeader*>(m_data);
+    const uint64_t tocEnd = sizeof(AssetPackHeader) + header.entryCount * sizeof(AssetPackEntry);
+    bool bValid = header.magic == s_magic && header.version == s_version &&
+                  header.entryCount <= (m_size - sizeof(AssetPackHeader)) / sizeof(AssetPackEntry);
+    if(bValid)
+    {
+        m_entries = reinterpret_cast<const AssetPackEntry*>(m_data + sizeof(AssetPackHeader));
+        m_entryCount = static_cast<size_t>(header.entryCount);
+        m_names = reinterpret_cast<const char*>(m_data + tocEnd);
+    }
+    for(size_t i = 0; bValid && i < m_entryCount; ++i)
+    {
+        const AssetPackEntry& entry = m_entries[i];
+        bValid = entry.offset <= m_size && entry.size <= m_size - entry.offset &&
+                 tocEnd + entry.nameOffset + entry.nameSize <= m_size &&
+                 (i == 0 || Entry_Less(m_entries[i - 1], entry));
+    }
+    if(!bValid)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Invalid asset pack ", path);
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void AssetPack::Close()
+{
+#ifdef CHERRY_HAS_MMAP
+    if(m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_entries = nullptr;
+    m_entryCount = 0;
+    m_names = nullptr;
+}
+
+const AssetPackEntry* AssetPack::Find(AssetId id, EPackAssetType type) const
+{
+    const AssetPackEntry key{id.hash, 0, 0, 0, static_cast<uint32_t>(type), 0, 0};
+    const AssetPackEntry* end = m_entries + m_entryCount;
+    const AssetPackEntry* found = std::lower_bound(m_entries, end, key, Entry_Less);
+    if(found == end || found->id != key.id || found->type != key.type ||
+       found->compression != static_cast<uint32_t>(EPackCompression::None))
+    {
+        return nullptr;
+    }
+    return found;
+}
+
+std::string_view AssetPack::GetName(const AssetPackEntry& entry) const
+{
+    return std::string_view(m_names + entry.nameOffset, entry.nameSize);
+}
+
+bool AssetPack::Write(const std::string& path, const std::vector<PackSource>& sources)
+{
+    // entries in table of contents order, with the file each one is read from
+    std::vector<std::pair<AssetPackEntry, const PackSource*>> entries;
+    std::string names;
+    for(const PackSource& source : sources)
+    {
+        AssetPackEntry entry{Asset_Id(source.name).hash, 0, 0, static_cast<uint32_t>(EPackCompression::None), static_cast<uint32_t>(source.type),
+                             static_cast<uint32_t>(names.size()), static_cast<uint32_t>(source.name.size())};
+        names += source.name;
+        entries.emplace_back(entry, &source);
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b){ return Entry_Less(a.first, b.first); });
+    for(size_t i = 1; i < entries.size(); ++i)
+    {
+        if(!Entry_Less(entries[i - 1].first, entries[i].first))
+        {
+            Debug_Log(ELogCategory::Error, EPrintColor::Red, "Two pack entries for ", entries[i].second->name, " and ", entries[i - 1].second->name);
+            return false;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        return false;
+    }
+    const AssetPackHeader header{s_magic, s_version, entries.size()};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    // the table of contents is written again once the offsets and sizes are known
+    std::vector<AssetPackEntry> toc(entries.size());
+    file.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(AssetPackEntry));
+    file.write(names.data(), names.size());
+    for(size_t i = 0; i < entries.size(); ++i)
+    {
+        std::ifstream blob(entries[i].second->path, std::ios::binary);
+        if(!blob)
+        {
+            Debug_Log(ELogCategory::Error, EPrintColor::Red, "Could not read ", entries[i].second->path);
+            return false;
+        }
+        const uint64_t position = static_cast<uint64_t>(file.tellp());
+        const uint64_t offset = (position + s_blobAlignment - 1) & ~(s_blobAlignment - 1);
+        const char zeros[s_blobAlignment] = {};
+        file.write(zeros, offset - position);
+        // copying an empty file would fail the stream
+        if(blob.peek() != std::ifstream::traits_type::eof())
+        {
+            file << blob.rdbuf();
+        }
+        toc[i] = entries[i].first;
+        toc[i].offset = offset;
+        toc[i].size = static_cast<uint64_t>(file.tellp()) - offset;
+    }
+    file.seekp(sizeof(AssetPackHeader));
+    file.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(AssetPackEntry));
+    return static_cast<bool>(file);
+}
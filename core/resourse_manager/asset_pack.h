@@ -0,0 +1,113 @@
+#pragma once
+
+/*
+ * All assets in one file, written by the cherry_pack tool(tools/cherry_pack, "make pack_assets").
+ * The pack is mapped read only: an asset is a pointer into the page cache, finding one is a binary search
+ * of the table of contents. Loading from a pack is one open() and one mmap() instead of an open/read/close
+ * per file, and the OS reads the file front to back.
+ *
+ * Layout, little endian:
+ *   AssetPackHeader
+ *   AssetPackEntry[entryCount]    sorted by id, then type
+ *   names                         file names of the entries, not terminated
+ *   blobs                         the asset files as they are, each one starts on a s_blobAlignment boundary
+ *
+ * An id can have two entries: the source image and the texture cherry_cook made from it.
+ *
+ * Example usage:
+ * @code
+ * AssetPack pack;
+ * if(pack.Open("../assets.cpak"))
+ * {
+ *     const AssetPackEntry* entry = pack.Find("berserk.png"_asset, EPackAssetType::Image);
+ *     if(entry) { DecodedImage image = Texture::decode(pack.GetData(*entry), entry->size); }
+ * }
+ * @endcode
+ */
+
+#include <asset_id.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* What a blob holds */
+enum class EPackAssetType : uint32_t
+{
+    Image = 0,        /* the file from assets/, png or anything else stb_image reads */
+    CookedTexture = 1 /* a .ctex file from cherry_cook(see cooked_texture.h) */
+};
+
+/* How a blob is stored, the loader skips entries with a compression it does not know */
+enum class EPackCompression : uint32_t
+{
+    None = 0 /* images are compressed already, cooked textures are block compressed or meant to be mapped */
+};
+
+struct AssetPackHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+};
+
+struct AssetPackEntry
+{
+    uint64_t id;          // AssetId of the file name
+    uint64_t offset;      // from the start of the file
+    uint64_t size;
+    uint32_t compression; // EPackCompression
+    uint32_t type;        // EPackAssetType
+    uint32_t nameOffset;  // from the start of the names
+    uint32_t nameSize;
+};
+
+/* A file to put in a pack */
+struct PackSource
+{
+    std::string name;
+    EPackAssetType type;
+    std::string path;
+};
+
+class AssetPack
+{
+public:
+    static constexpr uint32_t s_magic = 0x4B415043; // "CPAK"
+    static constexpr uint32_t s_version = 1;
+    // cache line, also more than the 16 byte alignment cooked texture levels need
+    static constexpr uint64_t s_blobAlignment = 64;
+
+    AssetPack() = default;
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Maps the pack read only, false if it is missing, truncated or from another version
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_data != nullptr; }
+
+    // Null if the pack has no such asset
+    const AssetPackEntry* Find(AssetId id, EPackAssetType type) const;
+    const AssetPackEntry* GetEntries() const { return m_entries; }
+    size_t GetEntryCount() const { return m_entryCount; }
+
+    const uint8_t* GetData(const AssetPackEntry& entry) const { return m_data + entry.offset; }
+    std::string_view GetName(const AssetPackEntry& entry) const;
+
+    // Reads the source files and writes the pack, the sources may come in any order
+    static bool Write(const std::string& path, const std::vector<PackSource>& sources);
+
+private:
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+    const AssetPackEntry* m_entries = nullptr;
+    size_t m_entryCount = 0;
+    const char* m_names = nullptr;
+    // platforms without mmap read the file into memory instead
+    std::vector<uint8_t> m_buffer;
+};
@@ -1,52 +1,729 @@
 #include <resource_manager.h>
 
 #include "../render/basic_texture.h"
+#include "../render/cooked_texture.h"
+#include "../render/dynamic_texture.h"
+#include "../render/texture_atlas.h"
+#include "../render/texture_streamer.h"
 
+#include <benchmark_component.h>
 #include <debug_logger_component.h>
+#include <file_watcher_component.h>
+#include <hash_component.h>
+#include <release_logger_component.h>
+#include <thread_pool.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <iostream>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Minimum time when the cooked file does not exist, the source is then always newer
+static std::filesystem::file_time_type Cooked_Write_Time(const std::string& path)
+{
+    std::error_code error;
+    std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+    return error ? std::filesystem::file_time_type::min() : time;
+}
+
+// Equal for byte identical images of the same size and format, format tells decoded and cooked pixels apart
+static uint64_t Content_Hash(const void* data, size_t size, int width, int height, uint32_t format)
+{
+    return Hash_Bytes_64(data, size, (static_cast<uint64_t>(width) << 40) ^ (static_cast<uint64_t>(height) << 16) ^ format);
+}
+
+static uint64_t Content_Hash(const CookedTexture& cooked)
+{
+    const CookedMip base = cooked.getMip(0);
+    return Content_Hash(base.data, base.size, cooked.getWidth(), cooked.getHeight(), 0x100 | static_cast<uint32_t>(cooked.getFormat()));
+}
+
+static uint64_t Content_Hash(const DecodedImage& image)
+{
+    return Content_Hash(image.data.get(), static_cast<size_t>(image.width) * image.height * image.nrChannels,
+                        image.width, image.height, static_cast<uint32_t>(image.nrChannels));
+}
 
 ResourceManager::ResourceManager()
+    : m_streamer(std::make_unique<TextureStreamer>())
+{
+    // Evicted textures stream back in from the pack they were loaded from
+    m_streamer->setDecoder([this](const std::string& path)
+    {
+        const AssetPackEntry* entry = m_pack.IsOpen() ? m_pack.Find(Asset_Id(std::filesystem::path(path).filename().string()), EPackAssetType::Image) : nullptr;
+        DecodedImage image = entry ? Texture::decode(m_pack.GetData(*entry), entry->size) : Texture::decode(path);
+        // lazy loads are hashed here, the pixels are gone once the texture is uploaded
+        bool bWanted = false;
+        {
+            std::lock_guard<std::mutex> lock(m_lazyContentMutex);
+            bWanted = m_lazyContent.contains(path);
+        }
+        if(bWanted && image.data)
+        {
+            const uint64_t contentHash = Content_Hash(image);
+            std::lock_guard<std::mutex> lock(m_lazyContentMutex);
+            m_lazyContent[path] = contentHash;
+        }
+        return image;
+    });
+    // and evicted cooked textures from their cooked texture, they stay block compressed
+    m_streamer->setCookedSource([this](const std::string& path, CookedTexture& cooked)
+    {
+        auto asset = m_catalog.find(Asset_Id(std::filesystem::path(path).filename().string()));
+        return asset != m_catalog.end() && OpenCooked(asset->second, cooked);
+    });
+}
+
+ResourceManager::~ResourceManager()
 {
 }
 
-// Loads all resources from the assets folder
+// Decoded on a worker, with the time the decode took there
+struct TimedDecode
+{
+    DecodedImage image;
+    uint64_t contentHash{0};
+    std::chrono::milliseconds time{0};
+};
+
+// A decode started by LoadResources
+struct PendingDecode
+{
+    std::string name;
+    std::string path;
+    // another file in assets/ already has the name, it is only loaded to check it is the same image
+    bool bNameTaken;
+    std::future<TimedDecode> future;
+};
+
+// One line of the LoadResources report
+struct AssetTiming
+{
+    std::string name;
+    const char* source; // "cooked", "decoded", "atlas" or "shared"
+    std::chrono::milliseconds decode{0};
+    std::chrono::milliseconds upload{0};
+};
+
+// Indexes the assets folder and loads the preload assets
 // Currently supports only texutres
-void ResourceManager::LoadResources()
+void ResourceManager::LoadResources(const std::vector<AssetId>& preload)
 {
+    BenchMarkExecution timer(EPrintColor::LightCyan);
+    timer.Save_Time_Point();
+
     // The path to the assets folder
     std::string path_to_data = "../assets";
 
-    for(const auto& cur_path : std::filesystem::recursive_directory_iterator(path_to_data))
+    // Decoding runs on the workers, this thread uploads the textures in the order they finish decoding.
+    // Shaders started before this compile in the driver at the same time.
+    // Texture::decode sets the stb_image flip flag of its own thread on every call, so the decodes do not race on it.
+    ThreadPool pool(std::thread::hardware_concurrency());
+    std::vector<PendingDecode> decodes;
+    std::unordered_set<std::string> names;
+    std::vector<AssetTiming> timings;
+
+    // Byte identical images(copies under another name or in another folder) share one texture.
+    // A 64 bit hash is trusted to tell images apart, the pixels are not compared.
+    std::unordered_map<uint64_t, std::shared_ptr<Texture>> texturesByContent;
+    // the name of the first atlas candidate with the content, the texture exists only after the atlas is built
+    std::unordered_map<uint64_t, std::string> atlasByContent;
+    // name -> name of the texture with the same content, resolved after the atlas is built
+    std::vector<std::pair<std::string, std::string>> atlasAliases;
+    std::unordered_map<std::string, uint64_t> contentByName;
+    // files whose name was taken, with their content
+    std::vector<std::pair<std::string, uint64_t>> nameClashes;
+
+    // A pack built by "make pack_assets" replaces the folder: one mapped file instead of a file per asset
+    std::vector<AssetSource> sources;
+    if(m_pack.IsOpen() || m_pack.Open(s_packPath))
     {
-        // skip folder names
-        if(std::filesystem::is_directory(cur_path)) { continue; }
+        for(size_t i = 0; i < m_pack.GetEntryCount(); ++i)
+        {
+            const AssetPackEntry& entry = m_pack.GetEntries()[i];
+            if(entry.type == static_cast<uint32_t>(EPackAssetType::Image) && entry.compression == static_cast<uint32_t>(EPackCompression::None))
+            {
+                std::string name(m_pack.GetName(entry));
+                sources.push_back({name, path_to_data + "/" + name, &entry, m_pack.Find(AssetId{entry.id}, EPackAssetType::CookedTexture)});
+            }
+        }
+    }
+    else
+    {
+        for(const auto& cur_path : std::filesystem::recursive_directory_iterator(path_to_data))
+        {
+            // skip folder names
+            if(std::filesystem::is_directory(cur_path)) { continue; }
+            sources.push_back({cur_path.path().filename().string(), cur_path.path().string()});
+        }
+    }
 
-        std::shared_ptr<Texture> texture = std::make_shared<Texture>("../assets/" + cur_path.path().filename().string());
-        if(m_textures.count(cur_path.path().filename().string()) == 0)
+    // Everything found can be loaded on first request, a name repeated in another folder is loaded from its first file
+    m_catalog.clear();
+    for(const AssetSource& source : sources)
+    {
+        m_catalog.emplace(Asset_Id(source.name), source);
+    }
+    const std::unordered_set<AssetId, AssetIdHash> preloadIds(preload.begin(), preload.end());
+
+    for(const AssetSource& source : sources)
+    {
+        const std::string& name = source.name;
+        if(!preloadIds.contains(Asset_Id(name)))
         {
-            // TODO(Alex): asssosiate the textures with a key different then their name
-            m_textures[cur_path.path().filename().string()] = texture;
+            continue;
         }
-        else
+        const bool bNameTaken = !names.insert(name).second;
+        // a name taken in this load is checked for same content below, one from an earlier load is lost
+        if(!bNameTaken && FindTexture(Asset_Id(name)))
         {
-            Debug_Log(ELogCategory::Error, EPrintColor::Red, "DUPLICATE KEY FOUND!: ", cur_path.path().filename().string());
+            Debug_Log(ELogCategory::Error, EPrintColor::Red, "DUPLICATE KEY FOUND!: ", name);
             Debug_Log(ELogCategory::Error, EPrintColor::Red, "This happens when two resources have the same name which leads to one of them being lost");
+            continue;
+        }
+        // Textures cooked by cherry_cook(make cook_assets) are uploaded as they are, nothing to decode
+        CookedTexture cooked;
+        // (a block compressed one only if the driver can sample it, the source image is the fallback)
+        timer.Save_Time_Point();
+        if(OpenCooked(source, cooked) && Texture::supportsCookedFormat(cooked.getFormat()))
+        {
+            const uint64_t contentHash = Content_Hash(cooked);
+            if(bNameTaken)
+            {
+                timer.Pop_Last_Point();
+                nameClashes.emplace_back(name, contentHash);
+                continue;
+            }
+            contentByName[name] = contentHash;
+            auto shared = texturesByContent.find(contentHash);
+            if(shared != texturesByContent.end())
+            {
+                SetTexture(name, shared->second);
+                timings.push_back({name, "shared", std::chrono::milliseconds(0), timer.Pop_Last_Point()});
+                continue;
+            }
+            const std::shared_ptr<Texture>& texture = SetTexture(name, std::make_shared<Texture>(source.path, cooked));
+            m_textureBudget.track(texture);
+            texturesByContent[contentHash] = texture;
+            timings.push_back({name, "cooked", std::chrono::milliseconds(0), timer.Pop_Last_Point()});
+            continue;
+        }
+        timer.Pop_Last_Point();
+        // packed files are decoded straight out of the mapping
+        const uint8_t* packed = source.image ? m_pack.GetData(*source.image) : nullptr;
+        const size_t packedSize = source.image ? static_cast<size_t>(source.image->size) : 0;
+        decodes.push_back({name, source.path, bNameTaken, pool.Add_Task([path = source.path, packed, packedSize]()
+        {
+            BenchMarkExecution decodeTimer;
+            decodeTimer.Save_Time_Point();
+            TimedDecode decode;
+            decode.image = packed ? Texture::decode(packed, packedSize) : Texture::decode(path);
+            // hashed on the worker too, the pixels are still in its cache
+            const DecodedImage& image = decode.image;
+            if(image.data)
+            {
+                decode.contentHash = Content_Hash(image);
+            }
+            decode.time = decodeTimer.Pop_Last_Point();
+            return decode;
+        })});
+    }
+
+    // Small images share atlas pages, the rest get a texture of their own.
+    // The software renderer samples whole textures only, it keeps every image separate.
+    TextureAtlas atlas;
+    std::vector<std::pair<std::string, DecodedImage>> atlasCandidates;
+    std::vector<bool> uploaded(decodes.size(), false);
+    for(size_t remaining = decodes.size(); remaining > 0;)
+    {
+        // Every decode that is done gets uploaded back to back, then this thread sleeps until the next one is
+        bool bUploaded = false;
+        for(size_t i = 0; i < decodes.size(); ++i)
+        {
+            PendingDecode& pending = decodes[i];
+            const std::string& name = pending.name;
+            if(uploaded[i] || pending.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                continue;
+            }
+            uploaded[i] = true;
+            bUploaded = true;
+            --remaining;
+
+            TimedDecode decode = pending.future.get();
+            DecodedImage& image = decode.image;
+            if(pending.bNameTaken)
+            {
+                nameClashes.emplace_back(name, decode.contentHash);
+                continue;
+            }
+            if(image.data)
+            {
+                contentByName[name] = decode.contentHash;
+                auto shared = texturesByContent.find(decode.contentHash);
+                if(shared != texturesByContent.end())
+                {
+                    SetTexture(name, shared->second);
+                    timings.push_back({name, "shared", decode.time, std::chrono::milliseconds(0)});
+                    continue;
+                }
+                auto atlased = atlasByContent.find(decode.contentHash);
+                if(atlased != atlasByContent.end())
+                {
+                    atlasAliases.emplace_back(name, atlased->second);
+                    timings.push_back({name, "shared", decode.time, std::chrono::milliseconds(0)});
+                    continue;
+                }
+            }
+            if(!Texture::s_bCpuOnly && image.data && image.width <= TextureAtlas::s_maxImageSize && image.height <= TextureAtlas::s_maxImageSize)
+            {
+                atlasByContent[decode.contentHash] = name;
+                timings.push_back({name, "atlas", decode.time, std::chrono::milliseconds(0)});
+                atlasCandidates.emplace_back(name, std::move(image));
+                continue;
+            }
+            timer.Save_Time_Point();
+            const bool bDecoded = image.data != nullptr;
+            const std::shared_ptr<Texture>& texture = SetTexture(name, std::make_shared<Texture>(pending.path, std::move(image)));
+            m_textureBudget.track(texture);
+            if(bDecoded)
+            {
+                texturesByContent[decode.contentHash] = texture;
+            }
+            timings.push_back({name, "decoded", decode.time, timer.Pop_Last_Point()});
+        }
+        if(!bUploaded && remaining > 0)
+        {
+            // the oldest decode is the most likely to finish next
+            size_t oldest = std::find(uploaded.begin(), uploaded.end(), false) - uploaded.begin();
+            decodes[oldest].future.wait();
+        }
+    }
+
+    // Tallest first packs the skyline much tighter
+    timer.Save_Time_Point();
+    std::sort(atlasCandidates.begin(), atlasCandidates.end(), [](const auto& a, const auto& b){ return a.second.height > b.second.height; });
+    for(const auto& [name, image] : atlasCandidates)
+    {
+        atlas.add(name, image);
+    }
+    for(auto& [name, texture] : atlas.build())
+    {
+        SetTexture(name, std::move(texture));
+    }
+    for(const auto& [name, original] : atlasAliases)
+    {
+        SetTexture(name, FindTexture(Asset_Id(original)));
+    }
+    const std::chrono::milliseconds atlasTime = timer.Pop_Last_Point();
+
+    // Assets loaded later on first request share these too
+    for(const auto& [contentHash, texture] : texturesByContent)
+    {
+        m_texturesByContent[contentHash] = texture;
+    }
+    for(const auto& [contentHash, name] : atlasByContent)
+    {
+        m_texturesByContent[contentHash] = FindTexture(Asset_Id(name));
+    }
+
+    // A name used twice is harmless when both files hold the same image
+    for(const auto& [name, contentHash] : nameClashes)
+    {
+        auto registered = contentByName.find(name);
+        if(registered != contentByName.end() && registered->second == contentHash)
+        {
+            continue;
+        }
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "DUPLICATE KEY FOUND!: ", name);
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "This happens when two resources have the same name which leads to one of them being lost");
+    }
+
+    // Startup report, the decode times add up to more than the total when the workers overlap
+    std::chrono::milliseconds decodeTotal{0}, uploadTotal{0};
+    size_t sharedCount = 0;
+    for(const AssetTiming& timing : timings)
+    {
+        Debug_Log(ELogCategory::Core, timer.Get_Print_Color(), timing.name, " (", timing.source, "): decode ", timing.decode.count(),
+                  "ms, upload ", timing.upload.count(), "ms");
+        decodeTotal += timing.decode;
+        uploadTotal += timing.upload;
+        sharedCount += std::strcmp(timing.source, "shared") == 0 ? 1 : 0;
+    }
+    Release_Log(ELogCategory::Core, timer.Get_Print_Color(), "LoadResources: ", m_catalog.size(), " assets, ", timings.size(), " textures preloaded in ", timer.Pop_Last_Point().count(),
+                "ms (decode ", decodeTotal.count(), "ms on ", std::thread::hardware_concurrency(), " workers, upload ", uploadTotal.count(),
+                "ms, atlas ", atlasTime.count(), "ms for ", atlas.getPagesCount(), " pages, ", sharedCount, " duplicates shared)");
+}
+
+bool ResourceManager::OpenCooked(const AssetSource& source, CookedTexture& cooked) const
+{
+    if(source.image)
+    {
+        return source.cooked && cooked.openMemory(m_pack.GetData(*source.cooked), source.cooked->size);
+    }
+    // A source deleted or renamed since it was indexed(routine with hot reload) can not tell whether the cooked one is stale
+    std::error_code error;
+    const std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(source.path, error);
+    const std::string cookedPath = "../cooked/" + source.name + ".ctex";
+    return !error && sourceTime <= Cooked_Write_Time(cookedPath) && cooked.open(cookedPath);
+}
+
+const std::shared_ptr<Texture>& ResourceManager::LoadTexture(AssetId id)
+{
+    const std::shared_ptr<Texture>& loaded = FindTexture(id);
+    auto asset = m_catalog.find(id);
+    if(loaded || asset == m_catalog.end())
+    {
+        return loaded;
+    }
+    // Same choice as LoadResources, without the atlas: it is built once for the preloaded batch.
+    // An image already loaded under another name is shared, an atlased one included.
+    const AssetSource& source = asset->second;
+    CookedTexture cooked;
+    std::shared_ptr<Texture> texture;
+    if(OpenCooked(source, cooked) && Texture::supportsCookedFormat(cooked.getFormat()))
+    {
+        const uint64_t contentHash = Content_Hash(cooked);
+        auto shared = m_texturesByContent.find(contentHash);
+        if(shared != m_texturesByContent.end() && !shared->second.expired())
+        {
+            Debug_Log(ELogCategory::Core, EPrintColor::LightCyan, "Loading ", source.name, " on first request, shared with an identical image");
+            return SetTexture(source.name, shared->second.lock());
+        }
+        texture = std::make_shared<Texture>(source.path, cooked);
+        m_texturesByContent[contentHash] = texture;
+    }
+    else
+    {
+        // decoded from the pack when the file is in it(see the streamer's decoder), the content is known once it is
+        {
+            std::lock_guard<std::mutex> lock(m_lazyContentMutex);
+            m_lazyContent[source.path] = 0;
+        }
+        texture = m_streamer->request(source.path);
+        m_lazyLoads.push_back({source.name, source.path, texture});
+    }
+    m_textureBudget.track(texture);
+    Debug_Log(ELogCategory::Core, EPrintColor::LightCyan, "Loading ", source.name, " on first request");
+    return SetTexture(source.name, std::move(texture));
+}
+
+void ResourceManager::UpdateLazyLoads()
+{
+    for(size_t i = 0; i < m_lazyLoads.size();)
+    {
+        LazyLoad& load = m_lazyLoads[i];
+        std::shared_ptr<Texture> texture = load.texture.lock();
+        // still streaming
+        if(texture && !texture->isResident() && FindTexture(Asset_Id(load.name)) == texture)
+        {
+            ++i;
+            continue;
+        }
+        uint64_t contentHash = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_lazyContentMutex);
+            auto hashed = m_lazyContent.find(load.path);
+            if(hashed != m_lazyContent.end())
+            {
+                contentHash = hashed->second;
+                m_lazyContent.erase(hashed);
+            }
         }
+        // unloaded or replaced while streaming, or the decode failed
+        if(texture && contentHash != 0 && FindTexture(Asset_Id(load.name)) == texture)
+        {
+            std::shared_ptr<Texture> shared = m_texturesByContent[contentHash].lock();
+            if(shared && shared != texture)
+            {
+                // handles resolve to the shared texture from now on, the copy goes once nothing holds it
+                SetTexture(load.name, std::move(shared));
+                Debug_Log(ELogCategory::Core, EPrintColor::LightCyan, load.name, " is identical to a loaded image, sharing its texture");
+            }
+            else
+            {
+                m_texturesByContent[contentHash] = texture;
+            }
+        }
+        m_lazyLoads[i] = std::move(m_lazyLoads.back());
+        m_lazyLoads.pop_back();
+    }
+}
+
+std::shared_ptr<Texture> ResourceManager::GetTexturePtr(AssetId id)
+{
+    const std::shared_ptr<Texture>& texture = LoadTexture(id);
+    if (!texture)
+    {
+        std::cerr << "Error: Texture " << GetAssetName(id) << " not found in resource manager." << std::endl;
+    }
+    return texture;
+}
+
+Texture& ResourceManager::GetTexture(AssetId id)
+{
+    return *LoadTexture(id);
+}
+
+TextureHandle ResourceManager::GetTextureHandle(AssetId id)
+{
+    if(!LoadTexture(id))
+    {
+        std::cerr << "Error: Texture " << GetAssetName(id) << " not found in resource manager." << std::endl;
+        return TextureHandle{};
+    }
+    const TextureHandle handle = m_textures.find(id)->second;
+    ++m_textureSlots[handle.index].refCount;
+    return handle;
+}
+
+void ResourceManager::ReleaseTextureHandle(TextureHandle handle)
+{
+    if(handle.index >= m_textureSlots.size())
+    {
+        return;
+    }
+    TextureSlot& slot = m_textureSlots[handle.index];
+    // released twice, or after the texture was unloaded
+    if(slot.generation != handle.generation || slot.refCount == 0)
+    {
+        return;
+    }
+    if(--slot.refCount == 0)
+    {
+        StartUnloadDelay(handle);
+    }
+}
+
+void ResourceManager::StartUnloadDelay(TextureHandle handle)
+{
+    TextureSlot& slot = m_textureSlots[handle.index];
+    if(!m_catalog.contains(slot.id))
+    {
+        return;
+    }
+    slot.releasedFrame = Texture::s_currentFrame;
+    m_unreferencedTextures.push_back({handle, slot.releasedFrame});
+}
+
+std::string ResourceManager::GetAssetName(AssetId id) const
+{
+#ifdef DEBUG_MODE
+    auto found = m_assetNames.find(id);
+    if(found != m_assetNames.end())
+    {
+        return found->second;
+    }
+#endif /* DEBUG_MODE */
+    std::ostringstream hex;
+    hex << "0x" << std::hex << id.hash;
+    return hex.str();
+}
+
+const std::shared_ptr<Texture>& ResourceManager::FindTexture(AssetId id) const
+{
+    auto found = m_textures.find(id);
+    return found != m_textures.end() ? ResolveTexture(found->second) : s_noTexture;
+}
+
+const std::shared_ptr<Texture>& ResourceManager::SetTexture(const std::string& name, std::shared_ptr<Texture> texture)
+{
+    const AssetId id = Asset_Id(name);
+#ifdef DEBUG_MODE
+    auto [named, bNew] = m_assetNames.emplace(id, name);
+    if(!bNew && named->second != name)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "ASSET ID COLLISION!: ", name, " and ", named->second, " hash to the same id");
+    }
+#endif /* DEBUG_MODE */
+    auto found = m_textures.find(id);
+    if(found == m_textures.end())
+    {
+        TextureHandle handle;
+        if(!m_freeTextureSlots.empty())
+        {
+            handle.index = m_freeTextureSlots.back();
+            m_freeTextureSlots.pop_back();
+        }
+        else
+        {
+            handle.index = static_cast<uint32_t>(m_textureSlots.size());
+            m_textureSlots.emplace_back();
+        }
+        handle.generation = m_textureSlots[handle.index].generation;
+        m_textureSlots[handle.index].id = id;
+        // Only releasing the last handle starts the unload delay. Without handles nothing tells whether the
+        // shared_ptrs handed out by GetTexturePtr are still held, so such a texture stays loaded.
+        found = m_textures.emplace(id, handle).first;
+    }
+    TextureSlot& slot = m_textureSlots[found->second.index];
+    slot.texture = std::move(texture);
+    return slot.texture;
+}
+
+void ResourceManager::UnloadTexture(AssetId id)
+{
+    auto found = m_textures.find(id);
+    if(found == m_textures.end())
+    {
+        return;
     }
+    TextureSlot& slot = m_textureSlots[found->second.index];
+    slot.texture.reset();
+    slot.refCount = 0;
+    // 0 is the generation of invalid handles
+    slot.generation = slot.generation == UINT32_MAX ? 1 : slot.generation + 1;
+    m_freeTextureSlots.push_back(found->second.index);
+    m_textures.erase(found);
 }
 
-std::shared_ptr<Texture> ResourceManager::GetTexturePtr(const std::string& name)
+std::shared_ptr<Texture> ResourceManager::StreamTexture(const std::string& name)
 {
-    if (m_textures.count(name) == 0)
+    const std::shared_ptr<Texture>& loaded = FindTexture(Asset_Id(name));
+    if(loaded)
+    {
+        return loaded;
+    }
+    std::shared_ptr<Texture> texture = m_streamer->request("../assets/" + name);
+    SetTexture(name, texture);
+    m_textureBudget.track(texture);
+    return texture;
+}
+
+std::shared_ptr<DynamicTexture> ResourceManager::CreateDynamicTexture(const std::string& name, int width, int height, uint32_t clearColor)
+{
+    std::shared_ptr<DynamicTexture> texture = std::make_shared<DynamicTexture>(name, width, height, clearColor);
+    SetTexture(name, texture);
+    m_dynamicTextures.push_back(texture);
+    return texture;
+}
+
+void ResourceManager::EnableHotReload()
+{
+    if(m_assetWatcher)
+    {
+        return;
+    }
+    if(m_pack.IsOpen())
+    {
+        Debug_Log(ELogCategory::Core, EPrintColor::Yellow, "Assets are loaded from ", s_packPath, ", hot reload is off");
+        return;
+    }
+    m_hotReloadPool = std::make_unique<ThreadPool>(1);
+    m_assetWatcher = std::make_unique<FileWatcher>();
+    // Runs on the watcher thread, only queues the path
+    const bool bWatching = m_assetWatcher->Watch_Directory("../assets", [this](const std::string& path)
+    {
+        std::lock_guard<std::mutex> lock(m_changedAssetsMutex);
+        m_changedAssets.push_back(path);
+    });
+    if(!bWatching)
+    {
+        Debug_Log(ELogCategory::Error, EPrintColor::Red, "Could not watch ../assets, hot reload is off");
+    }
+}
+
+void ResourceManager::UpdateHotReload()
+{
+    std::vector<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(m_changedAssetsMutex);
+        changed.swap(m_changedAssets);
+    }
+    for(std::string& path : changed)
+    {
+        std::string name = std::filesystem::path(path).filename().string();
+        const AssetId id = Asset_Id(name);
+        // a new file can be loaded from now on
+        auto asset = m_catalog.emplace(id, AssetSource{name, path}).first;
+        // only the file the asset was loaded from(not one of the same name in another folder), and only once it is loaded
+        if(asset->second.path != path || !FindTexture(id))
+        {
+            continue;
+        }
+        // the cooked texture is older than the file now, the file itself is decoded
+        std::future<DecodedImage> decode = m_hotReloadPool->Add_Task([path](){ return Texture::decode(path); });
+        m_hotReloads.push_back({std::move(name), std::move(path), std::move(decode)});
+    }
+
+    // The old texture is drawn until the new one is uploaded, nothing shows the placeholder
+    for(size_t i = 0; i < m_hotReloads.size();)
     {
-        std::cerr << "Error: Texture " << name << " not found in resource manager." << std::endl;
-        return nullptr;  // Return empty shared_ptr
+        HotReload& reload = m_hotReloads[i];
+        if(reload.decode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++i;
+            continue;
+        }
+        DecodedImage image = reload.decode.get();
+        // a failed decode keeps the old texture, the error was logged by decode()
+        if(image.data && FindTexture(Asset_Id(reload.name)))
+        {
+            const std::shared_ptr<Texture>& texture = SetTexture(reload.name, std::make_shared<Texture>(reload.path, std::move(image)));
+            m_textureBudget.track(texture);
+            Debug_Log(ELogCategory::Core, EPrintColor::LightCyan, "Reloaded ", reload.name);
+        }
+        m_hotReloads.erase(m_hotReloads.begin() + i);
     }
-    return m_textures[name];
 }
 
-Texture& ResourceManager::GetTexture(const std::string& name)
+void ResourceManager::Update(float uploadBudgetMs)
 {
-    return *(m_textures[name].get());
+    // Textures drawn from here on count as used in the new frame
+    ++Texture::s_currentFrame;
+    m_streamer->update(uploadBudgetMs);
+    UpdateLazyLoads();
+    if(m_assetWatcher)
+    {
+        UpdateHotReload();
+    }
+
+    // Assets no handle refers to go once their delay is over, oldest first. Under memory pressure(over the budget,
+    // or the budget had to evict textures last frame) they go right away instead of waiting to be asked for again.
+    size_t residentBytes = m_textureBudget.getResidentBytes();
+    const bool bEvicting = m_textureBudget.getEvictedByLastUpdate() > 0;
+    size_t kept = 0;
+    for(const UnreferencedTexture& unreferenced : m_unreferencedTextures)
+    {
+        const TextureSlot& slot = m_textureSlots[unreferenced.handle.index];
+        // unloaded already, handed out again or released again later(the later entry counts)
+        if(slot.generation != unreferenced.handle.generation || slot.refCount > 0 || slot.releasedFrame != unreferenced.releasedFrame)
+        {
+            continue;
+        }
+        if(!bEvicting && residentBytes <= m_textureBudget.getBudget() && Texture::s_currentFrame - unreferenced.releasedFrame < m_unloadDelayFrames)
+        {
+            m_unreferencedTextures[kept++] = unreferenced;
+            continue;
+        }
+        // shared with an asset of the same content, or held by someone else, the memory stays
+        if(slot.texture && slot.texture.use_count() == 1)
+        {
+            residentBytes -= std::min(residentBytes, slot.texture->getByteSize());
+        }
+        Debug_Log(ELogCategory::Core, EPrintColor::LightCyan, "Unloading unused ", GetAssetName(slot.id));
+        UnloadTexture(slot.id);
+    }
+    m_unreferencedTextures.resize(kept);
+
+    m_textureBudget.update(*m_streamer);
+
+    for(size_t i = 0; i < m_dynamicTextures.size();)
+    {
+        std::shared_ptr<DynamicTexture> texture = m_dynamicTextures[i].lock();
+        if(!texture)
+        {
+            m_dynamicTextures[i] = std::move(m_dynamicTextures.back());
+            m_dynamicTextures.pop_back();
+            continue;
+        }
+        texture->uploadDirty();
+        ++i;
+    }
 }
@@ -80,7 +80,18 @@ public:
      */
     std::size_t Number_Of_Tasks() const noexcept;
 
+    /*
+     * @brief Whether the calling thread is a worker of any thread pool,
+     * work that would start threads of its own can run serially there instead
+     *
+     * @return bool
+     */
+    static bool Is_Worker_Thread() noexcept;
+
 private:
+    /* set by every worker thread before its task loop */
+    inline static thread_local bool s_is_worker{false};
+
     /* lock shared data */
     mutable std::mutex m_mutex;
     /* used to notify a thread in case it is waiting(this may happen outside of your program) */
@@ -47,6 +47,7 @@ inline ThreadPool::ThreadPool(uint32_t _number_of_threads) noexcept : m_threads_
     for(size_t i = 0; i < m_threads_count; ++i)
     {
         m_workers.emplace_back([this](){
+            s_is_worker = true;
             while(true)
             {
                 std::function<void()> task;
@@ -158,3 +159,8 @@ inline std::size_t ThreadPool::Number_Of_Tasks() const noexcept
     std::unique_lock<std::mutex> lock(m_mutex);
     return m_tasks.size();
 }
+
+inline bool ThreadPool::Is_Worker_Thread() noexcept
+{
+    return s_is_worker;
+}
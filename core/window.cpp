@@ -8,9 +8,16 @@
 /*
  * Handles window resize event.
  */
-static void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+void Window::FramebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    WindowData* data = static_cast<WindowData*>(glfwGetWindowUserPointer(window));
+    if (data->bOpenGL)
+    {
+        glViewport(0, 0, width, height);
+    }
+    // kept for the render graph, its passes set the viewport themselves
+    data->framebufferWidth = width;
+    data->framebufferHeight = height;
 }
 
 Window::Window()
@@ -24,15 +31,49 @@ Window::~Window()
 bool Window::Init(const std::string& windowName, int width, int height)
 {
     // Set all the required options for GLFW
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_OPENGL_API);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if(!CreateGLFWWindow(windowName, width, height, true))
+    {
+        return false;
+    }
+    glfwMakeContextCurrent(m_window);
+
+    // Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
+    // Needs to be called for each OpenGL Context(unless i want windows to share data)
+    int version = gladLoadGL(glfwGetProcAddress);
+    if (version == 0)
+    {
+        Debug_Log("Failed to initialize glad");
+        glfwDestroyWindow(m_window);
+        m_window = nullptr;
+        return false;
+    }
+    // Successfully loaded OpenGL
+    Debug_Log("Loaded OpenGL ", GLAD_VERSION_MAJOR(version), ".", GLAD_VERSION_MINOR(version));
+
+    glViewport(0, 0, m_data.framebufferWidth, m_data.framebufferHeight);
+    return true; // success
+}
+
+bool Window::InitSoftware(const std::string& windowName, int width, int height)
+{
+    // No context, the Software backend renders into its own color buffer
+    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+    return CreateGLFWWindow(windowName, width, height, false);
+}
+
+bool Window::CreateGLFWWindow(const std::string& windowName, int width, int height, bool bOpenGL)
+{
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 
     m_data.windowName = windowName;
     m_data.width = width;
     m_data.height = height;
     m_data.VSync = false;
+    m_data.bOpenGL = bOpenGL;
     if(!s_GLFWInitialized)
     {
         int success = glfwInit();
@@ -41,23 +82,18 @@ bool Window::Init(const std::string& windowName, int width, int height)
         s_GLFWInitialized = true;
     }
 
+    // nullptr when the requested context can not be created
     m_window = glfwCreateWindow(m_data.width, m_data.height, m_data.windowName.c_str(), nullptr, nullptr);
-    glfwMakeContextCurrent(m_window);
-    glfwSetWindowUserPointer(m_window, &m_data);
-
-    // Load OpenGL functions, gladLoadGL returns the loaded version, 0 on error.
-    // Needs to be called for each OpenGL Context(unless i want windows to share data)
-    int version = gladLoadGL(glfwGetProcAddress);
-    if (version == 0)
+    if(!m_window)
     {
-        Debug_Log("Failed to initialize glad");
-        return -1;
+        Debug_Log("Failed to create the GLFW window");
+        return false;
     }
-    // Successfully loaded OpenGL
-    Debug_Log("Loaded OpenGL ", GLAD_VERSION_MAJOR(version), ".", GLAD_VERSION_MINOR(version));
+    glfwSetWindowUserPointer(m_window, &m_data);
 
-    glViewport(0, 0, m_data.width, m_data.height);
-    glfwSetFramebufferSizeCallback(m_window, framebuffer_size_callback);
+    // Differs from the window size on high DPI displays
+    glfwGetFramebufferSize(m_window, &m_data.framebufferWidth, &m_data.framebufferHeight);
+    glfwSetFramebufferSizeCallback(m_window, FramebufferSizeCallback);
 
     return true; // success
 }
@@ -72,6 +108,26 @@ std::string Window::GetTitle()
     return m_data.windowName;
 }
 
+int Window::GetWidth() const
+{
+    return m_data.width;
+}
+
+int Window::GetHeight() const
+{
+    return m_data.height;
+}
+
+int Window::GetFramebufferWidth() const
+{
+    return m_data.framebufferWidth;
+}
+
+int Window::GetFramebufferHeight() const
+{
+    return m_data.framebufferHeight;
+}
+
 /* Returns the actual ptr to GLFWwindow */
 GLFWwindow* Window::GetGLFWwindow()
 {
@@ -81,13 +137,19 @@ GLFWwindow* Window::GetGLFWwindow()
 void Window::SetVSyncOn()
 {
     m_data.VSync = true;
-    glfwSwapInterval(1);
+    if(m_data.bOpenGL)
+    {
+        glfwSwapInterval(1);
+    }
 }
 
 void Window::SetVSyncOff()
 {
     m_data.VSync = false;
-    glfwSwapInterval(0);
+    if(m_data.bOpenGL)
+    {
+        glfwSwapInterval(0);
+    }
 }
 
 // Not tested
@@ -15,24 +15,41 @@ public:
     Window();
     ~Window();
     bool Init(const std::string& windowName = "Cherry Engine", int width = 1080, int height = 720);
+    // Creates the window without an OpenGL context for the Software backend, nothing is presented in it
+    bool InitSoftware(const std::string& windowName = "Cherry Engine", int width = 1080, int height = 720);
     bool DeInit();
     void SetVSyncOn();
     void SetVSyncOff();
     GLFWwindow* GetGLFWwindow();
     void SetTitle(const std::string& title);
     std::string GetTitle();
+    int GetWidth() const;
+    int GetHeight() const;
+    // Size of the default framebuffer in pixels, updated when it is resized
+    int GetFramebufferWidth() const;
+    int GetFramebufferHeight() const;
 
 private:
-    // Avoid multiple glfw initializations
-    inline static bool s_GLFWInitialized = false;
     struct WindowData
     {
         std::string windowName;
         int width;
         int height;
+        int framebufferWidth;
+        int framebufferHeight;
         bool VSync;
+        // false for windows made by InitSoftware(), there is no context to set the viewport of
+        bool bOpenGL;
     };
-    GLFWwindow* m_window;
+
+    // Handles window resize event, m_data is reached through the window user pointer
+    static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
+    // Creates the GLFW window with the hints already set, false when GLFW can not create it
+    bool CreateGLFWWindow(const std::string& windowName, int width, int height, bool bOpenGL);
+
+    // Avoid multiple glfw initializations
+    inline static bool s_GLFWInitialized = false;
+    GLFWwindow* m_window = nullptr;
     WindowData m_data;
 };
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <hash_component.h>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/*
+ * Asset file name hashed at compile time, "berserk.png"_asset.
+ * The ResourceManager keys its assets by the 64 bit hash, looking one up builds no string and hashes nothing at runtime.
+ * Names only known at runtime(directory scans, scripts) go through Asset_Id().
+ * DEBUG_MODE builds keep a reverse table in the ResourceManager to print the names back(GetAssetName).
+ */
+struct AssetId
+{
+    uint64_t hash;
+
+    bool operator==(const AssetId& other) const = default;
+};
+
+consteval AssetId operator""_asset(const char* name, size_t length)
+{
+    return AssetId{Hash_Fnv1a_64(std::string_view(name, length))};
+}
+
+constexpr AssetId Asset_Id(std::string_view name) noexcept
+{
+    return AssetId{Hash_Fnv1a_64(name)};
+}
+
+/* The id already is a hash, the maps use it as is */
+struct AssetIdHash
+{
+    size_t operator()(AssetId id) const noexcept { return static_cast<size_t>(id.hash); }
+};
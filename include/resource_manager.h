@@ -1,30 +1,234 @@
 #pragma once
 
 #include "../core/render/basic_texture.h"
+#include "../core/render/texture_budget.h"
+#include "../core/resourse_manager/asset_pack.h"
+#include "asset_id.h"
+#include "texture_handle.h"
 
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
+
+class TextureStreamer;
+class DynamicTexture;
+class CookedTexture;
+class FileWatcher;
+class ThreadPool;
 
 /*
- * ResourseManager currently loads all the resourses from the assets/ folder into RAM.
- * TODO(Alex): Make assets automatically load and unload based on when they are used.
+ * ResourseManager indexes the assets/ folder(or the pack built from it) and loads an asset the first time it is asked for.
+ * Assets are keyed by the hash of their file name, "berserk.png"_asset(see asset_id.h).
+ * Handles from GetTextureHandle are counted, an asset whose last handle is released is kept for the unload delay
+ * in case it is asked for again and unloaded afterwards(right away when over the texture budget).
+ * An asset that never had a handle(only GetTexturePtr/GetTexture) stays loaded until UnloadTexture().
+ * So memory holds what the current scene uses, not the whole assets/ folder.
+ * Textures that own their memory are kept under a budget, the least recently drawn ones are
+ * evicted when it is exceeded and streamed back in when they are drawn again(see TextureBudget).
  */
 
 class ResourceManager
 {
 public:
     ResourceManager();
+    ~ResourceManager();
+
+    /*
+     * Loads an asset that is not loaded yet: a cooked texture right away, an image is streamed in and shows
+     * a placeholder until then. Small textures preloaded by LoadResources are packed into atlas pages, the
+     * returned texture then shares its GL texture with the page and carries its area in uvMin/uvMax.
+     * An asset with the same image as a loaded one shares its texture, a streamed one from the frame it is resident on
+     * (handles resolve to the shared texture then, the shared_ptr returned before keeps the copy).
+     * The texture holds no handle, it is only unloaded once a handle to it is taken and released(the shared_ptr stays valid regardless).
+     */
+    std::shared_ptr<Texture> GetTexturePtr(AssetId id);
+    Texture& GetTexture(AssetId id);
+
+    /*
+     * Indexes the assets folder, or the pack when there is one. Only the preload assets are loaded now,
+     * in one batch decoded on all cores, the others on first request.
+     */
+    void LoadResources(const std::vector<AssetId>& preload = {});
+
+    /*
+     * Look the id up once and keep the handle, resolving it is a bounds checked array index.
+     * Loads the asset on first request, like GetTexturePtr, and keeps it loaded until the handle is released.
+     * The handle keeps resolving when the texture under the id is replaced, it stops once the id is unloaded.
+     * Returns an invalid handle if no texture or asset has the id.
+     */
+    TextureHandle GetTextureHandle(AssetId id);
+    // Once an asset has no handles left it is unloaded after the unload delay, the handle must not be resolved afterwards
+    void ReleaseTextureHandle(TextureHandle handle);
+    // Null if the texture was unloaded, no copy of the shared_ptr is made
+    const std::shared_ptr<Texture>& ResolveTexture(TextureHandle handle) const
+    {
+        if(handle.index < m_textureSlots.size() && m_textureSlots[handle.index].generation == handle.generation)
+        {
+            return m_textureSlots[handle.index].texture;
+        }
+        return s_noTexture;
+    }
+
+    /*
+     * Forgets the texture, it is freed once nothing else holds it. Handles to it stop resolving.
+     */
+    void UnloadTexture(AssetId id);
 
-    std::shared_ptr<Texture> GetTexturePtr(const std::string& name);
-    Texture& GetTexture(const std::string& name);
-    void LoadResources();
+    /*
+     * Frames an asset with no handles stays loaded, 0 unloads it in the next Update().
+     */
+    void SetUnloadDelay(uint64_t frames) { m_unloadDelayFrames = frames; }
+
+    /*
+     * File name the id was made from, only DEBUG_MODE builds keep the names(the id in hex otherwise).
+     */
+    std::string GetAssetName(AssetId id) const;
+
+    /*
+     * Returns the texture if it is loaded, otherwise starts loading it in the background
+     * and returns a texture that shows a placeholder until it is uploaded. Never blocks.
+     */
+    std::shared_ptr<Texture> StreamTexture(const std::string& name);
+
+    /*
+     * Creates a texture that is drawn into at runtime, found by GetTexturePtr(Asset_Id(name)) afterwards.
+     * Its changes are uploaded by Update(), not counted against the texture budget.
+     */
+    std::shared_ptr<DynamicTexture> CreateDynamicTexture(const std::string& name, int width, int height, uint32_t clearColor = 0);
+
+    /*
+     * Reloads a loaded asset whenever its file in the assets folder is saved, to iterate on it while the game runs.
+     * The file is decoded on a worker and Update() swaps the new texture into the slot: handles resolve to it
+     * from then on, shared_ptrs taken before keep the old one. Files added to the folder can be loaded afterwards.
+     * Call after LoadResources. Off for assets loaded from a pack, it is rebuilt with "make pack_assets".
+     */
+    void EnableHotReload();
+
+    /*
+     * Call once per frame on the GL thread, uploads streamed textures for at most uploadBudgetMs,
+     * the changed areas of dynamic textures, hot reloaded assets, unloads the assets no handle refers to any more once their
+     * unload delay is over and evicts textures while over the texture memory budget.
+     */
+    void Update(float uploadBudgetMs = 2.0f);
+
+    /*
+     * Texture memory the loaded textures may use, atlas pages are not counted.
+     */
+    void SetTextureBudget(size_t budgetBytes) { m_textureBudget.setBudget(budgetBytes); }
+    size_t GetTextureMemoryUsage() const { return m_textureBudget.getResidentBytes(); }
 
 private:
     /*
      * Loads all resources from assets folders.
      */
 
-    std::unordered_map<std::string, std::shared_ptr<Texture>> m_textures;
+    static constexpr size_t s_defaultTextureBudget = 512ull * 1024 * 1024;
+    // about 5 seconds at 60 fps, a scene switching back and forth does not reload everything
+    static constexpr uint64_t s_defaultUnloadDelayFrames = 300;
+    // written by "make pack_assets", loaded instead of the assets folder when it exists
+    static constexpr const char* s_packPath = "../assets.cpak";
+
+    struct TextureSlot
+    {
+        std::shared_ptr<Texture> texture;
+        uint32_t generation{1};
+        AssetId id{0};
+        // live handles from GetTextureHandle
+        uint32_t refCount{0};
+        // frame the last handle was released in
+        uint64_t releasedFrame{0};
+    };
+
+    // A file to load, from the assets folder or from the pack
+    struct AssetSource
+    {
+        std::string name;
+        // where the texture streams back in from after an eviction
+        std::string path;
+        // the packed file, read from path when null
+        const AssetPackEntry* image{nullptr};
+        // the packed cooked texture, null if the pack has none
+        const AssetPackEntry* cooked{nullptr};
+    };
+
+    // A slot whose texture no handle refers to, unloaded once its delay is over
+    struct UnreferencedTexture
+    {
+        TextureHandle handle;
+        uint64_t releasedFrame;
+    };
+
+    // An asset LoadTexture streams in, checked for an identical loaded image once it is resident
+    struct LazyLoad
+    {
+        std::string name;
+        std::string path;
+        std::weak_ptr<Texture> texture;
+    };
+
+    // A changed asset file decoding for hot reload
+    struct HotReload
+    {
+        std::string name;
+        std::string path;
+        std::future<DecodedImage> decode;
+    };
+
+    // Puts the texture under the id of the name, into the slot the id already has or a free one
+    const std::shared_ptr<Texture>& SetTexture(const std::string& name, std::shared_ptr<Texture> texture);
+    // Null if no texture has the id
+    const std::shared_ptr<Texture>& FindTexture(AssetId id) const;
+    // The loaded texture, loads the asset first if it is not. Null if neither a texture nor an asset has the id.
+    const std::shared_ptr<Texture>& LoadTexture(AssetId id);
+    // Opens the up to date cooked texture of the asset, false if there is none(or it is older than the source)
+    bool OpenCooked(const AssetSource& source, CookedTexture& cooked) const;
+    // Starts the unload delay of a slot no handle refers to, only assets are unloaded(they can be loaded again)
+    void StartUnloadDelay(TextureHandle handle);
+    // Lazily streamed textures that turned out identical to a loaded one are swapped for it
+    void UpdateLazyLoads();
+    // Decodes the files the watcher reported and swaps in the ones that are done
+    void UpdateHotReload();
+
+    inline static const std::shared_ptr<Texture> s_noTexture;
+
+    // asset id -> slot of its texture
+    std::unordered_map<AssetId, TextureHandle, AssetIdHash> m_textures;
+#ifdef DEBUG_MODE
+    // asset id -> file name, to print ids and to catch two names hashing to the same id
+    std::unordered_map<AssetId, std::string, AssetIdHash> m_assetNames;
+#endif /* DEBUG_MODE */
+    std::vector<TextureSlot> m_textureSlots;
+    std::vector<uint32_t> m_freeTextureSlots;
+    // every asset LoadResources found, by id(the first file when two have the same name)
+    std::unordered_map<AssetId, AssetSource, AssetIdHash> m_catalog;
+    // oldest release first, entries of slots handed out again are dropped by Update()
+    std::vector<UnreferencedTexture> m_unreferencedTextures;
+    uint64_t m_unloadDelayFrames = s_defaultUnloadDelayFrames;
+    // stays mapped, evicted textures are decoded from it again(declared first, the streamer's workers read it)
+    AssetPack m_pack;
+    // path -> content hash of the lazy loads, 0 until the streamer's worker decoded the path(declared before the streamer too)
+    std::mutex m_lazyContentMutex;
+    std::unordered_map<std::string, uint64_t> m_lazyContent;
+    // owns the placeholder texture, also reloads evicted textures
+    std::unique_ptr<TextureStreamer> m_streamer;
+    TextureBudget m_textureBudget{s_defaultTextureBudget};
+    // the slots own them, an entry is dropped here once its texture is replaced or unloaded
+    std::vector<std::weak_ptr<DynamicTexture>> m_dynamicTextures;
+
+    // Textures by the hash of their image, an asset loaded on first request shares the texture of an identical one
+    std::unordered_map<uint64_t, std::weak_ptr<Texture>> m_texturesByContent;
+    std::vector<LazyLoad> m_lazyLoads;
+
+    // Hot reload, everything is null until EnableHotReload()
+    std::vector<HotReload> m_hotReloads;
+    std::unique_ptr<ThreadPool> m_hotReloadPool;
+    // paths the watcher thread reported, taken by Update()
+    std::mutex m_changedAssetsMutex;
+    std::vector<std::string> m_changedAssets;
+    // declared last, its thread is joined before the members its callback writes are destroyed
+    std::unique_ptr<FileWatcher> m_assetWatcher;
 };
 
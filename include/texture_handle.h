@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+/*
+ * Refers to a texture of the ResourceManager without naming it.
+ * index is a slot of a dense array, generation tells whether the slot still holds the texture
+ * the handle was made for: unloading a texture bumps the generation of its slot, so old handles
+ * resolve to nothing instead of to whatever reuses the slot.
+ *
+ * Example usage:
+ * @code
+ * TextureHandle berserk = resourceManager.GetTextureHandle("berserk.png"_asset); // once, keeps it loaded
+ * renderer.drawQuad(position, size, resourceManager.ResolveTexture(berserk)); // every frame
+ * resourceManager.ReleaseTextureHandle(berserk); // when the scene is done with it
+ * @endcode
+ */
+struct TextureHandle
+{
+    uint32_t index{0};
+    // slots start at generation 1, a default constructed handle resolves to nothing
+    uint32_t generation{0};
+
+    bool IsValid() const { return generation != 0; }
+    bool operator==(const TextureHandle& other) const = default;
+};
@@ -0,0 +1,153 @@
+/*
+ * Round trips 4x4 blocks through the BC1 and BC7 encoders of block_compression.h and checks
+ * the decoded colors stay close to the originals. Returns non zero when a block does not.
+ */
+
+#include "../core/render/block_compression.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static void Decode_565(uint16_t packed, int color[3])
+{
+    const int r = (packed >> 11) & 31;
+    const int g = (packed >> 5) & 63;
+    const int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// Reference BC1 decoder, alpha is 255 except for the transparent index of the 3 color mode
+static void Decode_Block_BC1(const uint8_t input[8], uint8_t block[64])
+{
+    const uint16_t c0 = static_cast<uint16_t>(input[0] | (input[1] << 8));
+    const uint16_t c1 = static_cast<uint16_t>(input[2] | (input[3] << 8));
+    int palette[4][4] = {};
+    Decode_565(c0, palette[0]);
+    Decode_565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c)
+    {
+        palette[2][c] = c0 > c1 ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+        palette[3][c] = c0 > c1 ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+    }
+    for (int i = 0; i < 4; ++i) { palette[i][3] = (c0 <= c1 && i == 3) ? 0 : 255; }
+    uint32_t indices;
+    std::memcpy(&indices, input + 4, 4);
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const int* color = palette[(indices >> (pixel * 2)) & 3];
+        for (int c = 0; c < 4; ++c) { block[pixel * 4 + c] = static_cast<uint8_t>(color[c]); }
+    }
+}
+
+// Reference decoder of BC7 mode 6, the only mode the encoder writes
+static bool Decode_Block_BC7(const uint8_t input[16], uint8_t block[64])
+{
+    int bit = 0;
+    auto read = [&](int count)
+    {
+        int value = 0;
+        for (int i = 0; i < count; ++i, ++bit) { value |= ((input[bit / 8] >> (bit % 8)) & 1) << i; }
+        return value;
+    };
+    if (read(7) != 0x40)
+    {
+        return false;
+    }
+    int endpoints[2][4];
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = read(7);
+        endpoints[1][c] = read(7);
+    }
+    const int p0 = read(1);
+    const int p1 = read(1);
+    for (int c = 0; c < 4; ++c)
+    {
+        endpoints[0][c] = (endpoints[0][c] << 1) | p0;
+        endpoints[1][c] = (endpoints[1][c] << 1) | p1;
+    }
+    static constexpr int s_weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const int weight = s_weights[read(pixel == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; ++c)
+        {
+            block[pixel * 4 + c] = static_cast<uint8_t>(((64 - weight) * endpoints[0][c] + weight * endpoints[1][c] + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+static int Max_Error(const uint8_t a[64], const uint8_t b[64], int channels)
+{
+    int error = 0;
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        for (int c = 0; c < channels; ++c) { error = std::max(error, std::abs(a[pixel * 4 + c] - b[pixel * 4 + c])); }
+    }
+    return error;
+}
+
+static bool Check(const char* name, const uint8_t block[64], int maxErrorBC1, int maxErrorBC7)
+{
+    uint8_t encoded[16];
+    uint8_t decoded[64];
+    Encode_Block_BC1(block, encoded);
+    Decode_Block_BC1(encoded, decoded);
+    const int errorBC1 = Max_Error(block, decoded, 3);
+
+    Encode_Block_BC7(block, encoded);
+    const int errorBC7 = Decode_Block_BC7(encoded, decoded) ? Max_Error(block, decoded, 4) : 256;
+
+    const bool bPassed = errorBC1 <= maxErrorBC1 && errorBC7 <= maxErrorBC7;
+    std::printf("%s %s: BC1 max error %d(allowed %d), BC7 max error %d(allowed %d)\n", bPassed ? "PASS" : "FAIL", name,
+                errorBC1, maxErrorBC1, errorBC7, maxErrorBC7);
+    return bPassed;
+}
+
+int main()
+{
+    bool bPassed = true;
+    uint8_t block[64];
+
+    // Variation along (1,-1,0), orthogonal to the (1,1,1) axis the fit used to start from
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const bool bRed = ((pixel % 4) + (pixel / 4)) % 2 == 0;
+        const uint8_t texel[4] = {static_cast<uint8_t>(bRed ? 255 : 0), static_cast<uint8_t>(bRed ? 0 : 255), 0, 255};
+        std::memcpy(block + pixel * 4, texel, 4);
+    }
+    bPassed &= Check("red/green checker", block, 4, 4);
+
+    // Red against blue, along (1,0,-1)
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const bool bBlue = pixel % 2 == 0;
+        const uint8_t texel[4] = {static_cast<uint8_t>(bBlue ? 0 : 255), 0, static_cast<uint8_t>(bBlue ? 255 : 0), 255};
+        std::memcpy(block + pixel * 4, texel, 4);
+    }
+    bPassed &= Check("red/blue stripes", block, 4, 4);
+
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const uint8_t texel[4] = {90, 140, 200, 255};
+        std::memcpy(block + pixel * 4, texel, 4);
+    }
+    bPassed &= Check("flat", block, 4, 2);
+
+    // Grey ramp with a fading alpha, BC1 ignores the alpha. 16 levels on a 4 color palette are off by up to half a step(85 / 2).
+    for (int pixel = 0; pixel < 16; ++pixel)
+    {
+        const uint8_t value = static_cast<uint8_t>(pixel * 17);
+        const uint8_t texel[4] = {value, value, value, static_cast<uint8_t>(255 - value)};
+        std::memcpy(block + pixel * 4, texel, 4);
+    }
+    bPassed &= Check("ramp", block, 43, 12);
+
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+/*
+ * Writes cooked textures with CookedTexture::write, breaks their header and level table in the ways a truncated
+ * or hand edited .ctex file would and checks that opening them fails. Returns non zero when a check fails.
+ */
+
+#include "../core/render/cooked_texture.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+static int s_failures = 0;
+
+static void Check(bool bPassed, const char* what)
+{
+    if (!bPassed)
+    {
+        std::printf("FAILED: %s\n", what);
+        ++s_failures;
+    }
+}
+
+// A full chain from width x height down to 1x1, blockBytes 0 for uncompressed RGBA8
+static std::vector<MipLevel> Make_Levels(int width, int height, int blockBytes)
+{
+    std::vector<MipLevel> levels;
+    while (true)
+    {
+        MipLevel level;
+        level.width = width;
+        level.height = height;
+        const size_t size = blockBytes == 0 ? static_cast<size_t>(width) * height * 4
+                                            : static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+        level.pixels.assign(size, 0x7F);
+        levels.push_back(std::move(level));
+        if (width == 1 && height == 1)
+        {
+            return levels;
+        }
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+    }
+}
+
+static std::vector<uint8_t> Write_And_Read(ECookedFormat format, const std::vector<MipLevel>& levels)
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "cherry_cooked_texture_test.ctex";
+    CookedTexture::write(path.string(), format, levels);
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    std::filesystem::remove(path);
+    return data;
+}
+
+static bool Opens(const std::vector<uint8_t>& data)
+{
+    CookedTexture cooked;
+    return cooked.openMemory(data.data(), data.size());
+}
+
+static CookedTextureHeader& Header_Of(std::vector<uint8_t>& data)
+{
+    return *reinterpret_cast<CookedTextureHeader*>(data.data());
+}
+
+static CookedMipEntry& Entry_Of(std::vector<uint8_t>& data, uint32_t level)
+{
+    return reinterpret_cast<CookedMipEntry*>(data.data() + sizeof(CookedTextureHeader))[level];
+}
+
+int main()
+{
+    const std::vector<uint8_t> rgba = Write_And_Read(ECookedFormat::RGBA8, Make_Levels(5, 3, 0));
+    const std::vector<uint8_t> bc1 = Write_And_Read(ECookedFormat::BC1, Make_Levels(13, 6, 8));
+    const std::vector<uint8_t> bc7 = Write_And_Read(ECookedFormat::BC7, Make_Levels(8, 8, 16));
+    Check(Opens(rgba), "an RGBA8 texture written by write() opens");
+    Check(Opens(bc1), "a BC1 texture written by write() opens");
+    Check(Opens(bc7), "a BC7 texture written by write() opens");
+
+    std::vector<uint8_t> broken = rgba;
+    Header_Of(broken).width = 0;
+    Check(!Opens(broken), "a zero width is rejected");
+
+    broken = rgba;
+    Header_Of(broken).format = 99;
+    Check(!Opens(broken), "an unknown format is rejected");
+
+    broken = rgba;
+    Header_Of(broken).format = static_cast<uint32_t>(ECookedFormat::RGB8);
+    Check(!Opens(broken), "levels too large for the format are rejected");
+
+    broken = bc1;
+    Header_Of(broken).format = static_cast<uint32_t>(ECookedFormat::BC7);
+    Check(!Opens(broken), "BC1 sized levels are rejected as BC7");
+
+    broken = rgba;
+    Entry_Of(broken, 1).size -= 1;
+    Check(!Opens(broken), "a level smaller than its width and height need is rejected");
+
+    broken = rgba;
+    Entry_Of(broken, 0).width = 6;
+    Entry_Of(broken, 0).size = 6 * 3 * 4;
+    Check(!Opens(broken), "a level that does not match the header size is rejected");
+
+    broken = rgba;
+    Header_Of(broken).width = 64;
+    Check(!Opens(broken), "a header larger than the levels is rejected");
+
+    broken = bc7;
+    broken.resize(broken.size() - 1);
+    Check(!Opens(broken), "a truncated file is rejected");
+
+    if (s_failures == 0)
+    {
+        std::printf("cooked texture: all checks passed\n");
+    }
+    return s_failures == 0 ? 0 : 1;
+}
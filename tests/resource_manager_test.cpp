@@ -0,0 +1,98 @@
+/*
+ * Runs the ResourceManager in CPU only mode(no OpenGL context) on a throwaway assets folder and checks
+ * when assets are unloaded. Returns non zero when a check fails.
+ */
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <resource_manager.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+static int s_failures = 0;
+
+static void Check(bool bPassed, const char* what)
+{
+    if (!bPassed)
+    {
+        std::printf("FAILED: %s\n", what);
+        ++s_failures;
+    }
+}
+
+// 2x2 uncompressed 32 bit TGA, enough for stb_image. Images of another shade are not shared.
+static void Write_Image(const std::filesystem::path& path, uint8_t shade)
+{
+    const uint8_t header[18] = {0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 32, 8};
+    const uint8_t pixels[16] = {shade, 0, 0, 255, 0, shade, 0, 255, 0, 0, shade, 255, shade, shade, shade, 255};
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+}
+
+// Streamed textures are resident after a few updates, the decode runs on a worker
+static void Update_Until_Resident(ResourceManager& manager, const std::shared_ptr<Texture>& texture)
+{
+    for (int frame = 0; frame < 1000 && !texture->isResident(); ++frame)
+    {
+        manager.Update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int main()
+{
+    // The manager reads ../assets relative to the working directory
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "cherry_resource_manager_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root / "assets");
+    std::filesystem::create_directories(root / "build");
+    Write_Image(root / "assets" / "pointer.tga", 255);
+    Write_Image(root / "assets" / "handle.tga", 128);
+    std::filesystem::current_path(root / "build");
+
+    Texture::s_bCpuOnly = true;
+    {
+        ResourceManager manager;
+        manager.LoadResources();
+        manager.SetUnloadDelay(3);
+
+        // Only shared_ptrs, no handle: stays loaded past the unload delay
+        std::shared_ptr<Texture> pointer = manager.GetTexturePtr("pointer.tga"_asset);
+        Check(pointer != nullptr, "GetTexturePtr loads an asset on first request");
+        if (pointer)
+        {
+            Update_Until_Resident(manager, pointer);
+            Check(pointer->isResident(), "the streamed texture becomes resident");
+            for (int frame = 0; frame < 20; ++frame)
+            {
+                manager.Update();
+            }
+            Check(manager.GetTexturePtr("pointer.tga"_asset) == pointer, "a texture fetched with GetTexturePtr is not unloaded and loaded again");
+        }
+
+        // A released handle starts the delay, the asset is unloaded once it is over
+        TextureHandle handle = manager.GetTextureHandle("handle.tga"_asset);
+        Check(handle.IsValid(), "GetTextureHandle loads an asset on first request");
+        manager.ReleaseTextureHandle(handle);
+        for (int frame = 0; frame < 20; ++frame)
+        {
+            manager.Update();
+        }
+        Check(manager.ResolveTexture(handle) == nullptr, "an asset whose last handle was released is unloaded after the delay");
+    }
+
+    std::filesystem::current_path(root.parent_path());
+    std::filesystem::remove_all(root);
+    if (s_failures == 0)
+    {
+        std::printf("resource manager: all checks passed\n");
+    }
+    return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/*
+ * cherry_cook converts the images in assets/ into cooked textures(see core/render/cooked_texture.h)
+ * so the engine can skip decoding, flipping and mipmapping them at startup.
+ *
+ * Usage: cherry_cook <assets directory> <output directory> [--compress none|bc1|bc3|bc7|auto]
+ * Every image becomes <output directory>/<file name>.ctex, files older than their output are skipped.
+ * Files that are not images are skipped, so is a file whose name an earlier one already has.
+ * auto picks BC1 for opaque images and BC7 for images with alpha.
+ */
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "../../core/render/block_compression.h"
+#include "../../core/render/cooked_texture.h"
+#include "../../core/render/mip_generator.h"
+
+#include <thread_pool.h>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+enum class ECompression : unsigned char
+{
+    None,
+    BC1,
+    BC3,
+    BC7,
+    Auto
+};
+
+static bool Parse_Compression(const char* name, ECompression& compression)
+{
+    static constexpr std::pair<const char*, ECompression> s_names[] = {
+        {"none", ECompression::None}, {"bc1", ECompression::BC1}, {"bc3", ECompression::BC3},
+        {"bc7", ECompression::BC7}, {"auto", ECompression::Auto}
+    };
+    for (const auto& [candidate, value] : s_names)
+    {
+        if (std::strcmp(name, candidate) == 0)
+        {
+            compression = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Whether a cooked file of this format is what the requested compression would produce
+static bool Matches_Compression(ECookedFormat format, ECompression compression)
+{
+    switch (compression)
+    {
+        case ECompression::None: return !CookedTexture::isCompressed(format);
+        case ECompression::BC1:  return format == ECookedFormat::BC1;
+        case ECompression::BC3:  return format == ECookedFormat::BC3;
+        case ECompression::BC7:  return format == ECookedFormat::BC7;
+        case ECompression::Auto: return format == ECookedFormat::BC1 || format == ECookedFormat::BC7;
+    }
+    return false;
+}
+
+static bool Is_Up_To_Date(const std::filesystem::path& source, const std::filesystem::path& destination, ECompression compression)
+{
+    std::error_code error;
+    const auto cookedTime = std::filesystem::last_write_time(destination, error);
+    if (error || cookedTime < std::filesystem::last_write_time(source, error) || error)
+    {
+        return false;
+    }
+    CookedTexture cooked;
+    return cooked.open(destination.string()) && Matches_Compression(cooked.getFormat(), compression);
+}
+
+static bool Cook_Texture(const std::filesystem::path& source, const std::filesystem::path& destination, ECompression compression)
+{
+    // Same orientation the runtime loader produces
+    stbi_set_flip_vertically_on_load_thread(true);
+    int width = 0, height = 0, channels = 0;
+    if (!stbi_info(source.string().c_str(), &width, &height, &channels))
+    {
+        std::cerr << "cherry_cook: could not decode " << source << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+    // The GL formats the engine uses are RGB8 and RGBA8, grey is expanded to RGB8 and grey+alpha to RGBA8.
+    // The block encoders always take RGBA8.
+    const bool bHasAlpha = channels == 2 || channels == 4;
+    channels = (compression == ECompression::None && !bHasAlpha) ? 3 : 4;
+    stbi_uc* data = stbi_load(source.string().c_str(), &width, &height, nullptr, channels);
+    if (!data)
+    {
+        std::cerr << "cherry_cook: could not decode " << source << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    std::vector<MipLevel> levels(1);
+    levels[0].width = width;
+    levels[0].height = height;
+    levels[0].pixels.assign(data, data + static_cast<size_t>(width) * height * channels);
+    stbi_image_free(data);
+
+    std::vector<MipLevel> mips = Generate_Mip_Chain(levels[0].pixels.data(), width, height, channels);
+    levels.insert(levels.end(), std::make_move_iterator(mips.begin()), std::make_move_iterator(mips.end()));
+
+    ECookedFormat format = channels == 4 ? ECookedFormat::RGBA8 : ECookedFormat::RGB8;
+    if (compression != ECompression::None)
+    {
+        EBlockFormat blockFormat = EBlockFormat::BC7;
+        switch (compression)
+        {
+            case ECompression::BC1:  blockFormat = EBlockFormat::BC1; break;
+            case ECompression::BC3:  blockFormat = EBlockFormat::BC3; break;
+            case ECompression::Auto: blockFormat = bHasAlpha ? EBlockFormat::BC7 : EBlockFormat::BC1; break;
+            default: break;
+        }
+        format = blockFormat == EBlockFormat::BC1 ? ECookedFormat::BC1 : (blockFormat == EBlockFormat::BC3 ? ECookedFormat::BC3 : ECookedFormat::BC7);
+        // Every level is compressed on its own, the mips were filtered from the uncompressed pixels
+        for (MipLevel& level : levels)
+        {
+            level.pixels = Compress_Blocks(level.pixels.data(), level.width, level.height, blockFormat);
+        }
+    }
+
+    if (!CookedTexture::write(destination.string(), format, levels))
+    {
+        std::cerr << "cherry_cook: could not write " << destination << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    ECompression compression = ECompression::None;
+    const bool bCompressArgument = argc == 5 && std::strcmp(argv[3], "--compress") == 0;
+    if ((argc != 3 && !bCompressArgument) || (bCompressArgument && !Parse_Compression(argv[4], compression)))
+    {
+        std::cerr << "Usage: cherry_cook <assets directory> <output directory> [--compress none|bc1|bc3|bc7|auto]" << std::endl;
+        return 1;
+    }
+    const std::filesystem::path assets(argv[1]);
+    const std::filesystem::path output(argv[2]);
+    std::error_code error;
+    std::filesystem::create_directories(output, error);
+    if (error)
+    {
+        std::cerr << "cherry_cook: could not create " << output << ": " << error.message() << std::endl;
+        return 1;
+    }
+
+    ThreadPool pool(std::thread::hardware_concurrency());
+    std::vector<std::future<bool>> results;
+    std::atomic<uint32_t> cooked{0};
+    uint32_t upToDate = 0;
+    uint32_t skipped = 0;
+    std::unordered_set<std::string> names;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(assets))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+        // Not every file in assets/ is an image, those are no failure
+        int width = 0, height = 0, channels = 0;
+        if (!stbi_info(entry.path().string().c_str(), &width, &height, &channels))
+        {
+            std::cout << "cherry_cook: skipping " << entry.path() << ", not an image" << std::endl;
+            ++skipped;
+            continue;
+        }
+        // Named by file name like the ResourceManager keys, the first file of a name is the one it loads.
+        // A second one would be written to the same output by another worker at the same time.
+        const std::string name = entry.path().filename().string();
+        if (!names.insert(name).second)
+        {
+            std::cerr << "cherry_cook: skipping " << entry.path() << ", another file is named " << name << std::endl;
+            ++skipped;
+            continue;
+        }
+        std::filesystem::path destination = output / (name + ".ctex");
+        if (Is_Up_To_Date(entry.path(), destination, compression))
+        {
+            ++upToDate;
+            continue;
+        }
+        results.push_back(pool.Add_Task([source = entry.path(), destination, compression, &cooked]()
+        {
+            bool bCooked = Cook_Texture(source, destination, compression);
+            if (bCooked)
+            {
+                ++cooked;
+            }
+            return bCooked;
+        }));
+    }
+
+    bool bFailed = false;
+    for (std::future<bool>& result : results)
+    {
+        bFailed |= !result.get();
+    }
+    std::cout << "cherry_cook: " << cooked << " cooked, " << upToDate << " up to date, " << skipped << " skipped, "
+              << (results.size() - cooked) << " failed" << std::endl;
+    return bFailed ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * cherry_pack puts the files in assets/ into one asset pack(see core/resourse_manager/asset_pack.h)
+ * which the engine maps instead of opening every file on its own.
+ *
+ * Usage: cherry_pack <assets directory> <cooked directory> <output pack>
+ * Every file is packed as it is, together with its cooked texture(<cooked directory>/<file name>.ctex)
+ * when cherry_cook made one that is newer than the file. Run cook_assets first to pack the cooked textures.
+ */
+
+#include "../../core/render/cooked_texture.h"
+#include "../../core/resourse_manager/asset_pack.h"
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Same rule as the ResourceManager: a cooked texture older than its source is stale
+static bool Has_Cooked_Texture(const std::filesystem::path& source, const std::filesystem::path& cookedPath)
+{
+    std::error_code error;
+    const auto cookedTime = std::filesystem::last_write_time(cookedPath, error);
+    if (error || cookedTime < std::filesystem::last_write_time(source, error) || error)
+    {
+        return false;
+    }
+    CookedTexture cooked;
+    return cooked.open(cookedPath.string());
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: cherry_pack <assets directory> <cooked directory> <output pack>" << std::endl;
+        return 1;
+    }
+    const std::filesystem::path assets(argv[1]);
+    const std::filesystem::path cookedDirectory(argv[2]);
+    const std::string output(argv[3]);
+
+    std::vector<PackSource> sources;
+    std::unordered_set<std::string> names;
+    uint32_t cookedCount = 0;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(assets))
+    {
+        if (!entry.is_regular_file())
+        {
+            continue;
+        }
+        // Named by file name like the ResourceManager keys
+        const std::string name = entry.path().filename().string();
+        if (!names.insert(name).second)
+        {
+            std::cerr << "cherry_pack: skipping " << entry.path() << ", another file is named " << name << std::endl;
+            continue;
+        }
+        sources.push_back({name, EPackAssetType::Image, entry.path().string()});
+        const std::filesystem::path cookedPath = cookedDirectory / (name + ".ctex");
+        if (Has_Cooked_Texture(entry.path(), cookedPath))
+        {
+            sources.push_back({name, EPackAssetType::CookedTexture, cookedPath.string()});
+            ++cookedCount;
+        }
+    }
+
+    if (!AssetPack::Write(output, sources))
+    {
+        std::cerr << "cherry_pack: could not write " << output << std::endl;
+        return 1;
+    }
+    std::cout << "cherry_pack: " << names.size() << " files, " << cookedCount << " cooked textures in " << output << std::endl;
+    return 0;
+}